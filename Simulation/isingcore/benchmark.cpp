@@ -0,0 +1,214 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+#include "denselattice.h"
+#include "isinghelpers.h"
+#include "multispinlattice.h"
+#include "simulatedlattice.h"
+
+using namespace ising;
+
+std::mutex SimulatedLattice::file_mutex;
+
+const uint ARENA_TEMPERATURES = 32;
+const uint ICA_TEMPERATURES = 8;
+const uint WARMUP_SWEEPS = 10;
+
+// Every heap allocation of the process, so that update loops can be checked
+// to allocate nothing once warmed up
+static std::atomic<size_t> allocations(0);
+
+void *operator new(size_t size) {
+    ++allocations;
+
+    if (void *p = malloc(size)) {
+        return p;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+double timeSweeps(const std::function<void(void)> &sweep, uint sweeps) {
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint i = 0; i < sweeps; ++i) {
+        sweep();
+    }
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+void printRate(const std::string &name, double attempts, double seconds) {
+    std::cout << name << ":\t" << attempts / seconds / 1e6
+              << " million spin flip attempts/s (" << seconds << " s)"
+              << std::endl;
+}
+
+template <class J>
+void benchmarkDense(const DenseCouplings &dense, double t, uint sweeps) {
+    DenseLattice<J> lattice(dense, t, 0, 1, REPLICAS);
+    double numIndices = lattice.getNumIndices();
+    double seconds = timeSweeps([&] { lattice.monteCarloSweep(); }, sweeps);
+    std::string name = std::is_integral<J>::value
+                           ? "Dense (int" + std::to_string(8 * sizeof(J)) + ")"
+                           : "Dense (float)";
+    printRate(name, REPLICAS * numIndices * sweeps, seconds);
+}
+
+int main(int argc, char *argv[]) {
+    readOptionFlags(argc, argv);
+
+    if (argc != 2 && argc != 4) {
+        printf("Usage: %s name_of_hamiltonian_file [temperature sweeps] "
+               "[--isa=scalar|generic|avx2|avx512] [--order=n|l|h|r] "
+               "[--nfold=temperature] [--threads=n]\n\n",
+               argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    std::ifstream file(argv[1]);
+
+    if (!file) {
+        printf("Invalid file name. %s does not exist!\n\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+
+    double t = 2;
+    uint sweeps = 1000;
+
+    if (argc == 4) {
+        t = atof(argv[2]);
+        sweeps = atoi(argv[3]);
+    }
+
+    std::cout << std::endl << "Kernels: " << getKernels().name << std::endl;
+
+    // Fully connected inputs have their own engine and file format
+    if (file.peek() == DENSE) {
+        DenseCouplings dense = readDenseCouplings(file);
+        file.close();
+
+        if (dense.integral && dense.maxCoupling <= INT8_MAX) {
+            benchmarkDense<int8_t>(dense, t, sweeps);
+        }
+        if (dense.integral && dense.maxCoupling <= INT16_MAX) {
+            benchmarkDense<int16_t>(dense, t, sweeps);
+        }
+        benchmarkDense<float>(dense, t, sweeps);
+
+        std::cout << std::endl;
+        return 0;
+    }
+
+    char shape;
+    Hamiltonian h = readHamiltonian(file, shape);
+    h.printReduction();
+    file.close();
+
+    Lattice *lattice = chooseLattice(shape, h, t, 0, 1, PSEUDO);
+    double numIndices = lattice->getNumIndices();
+    bool pairwise = lattice->getInteractions().pairwise;
+    double seconds = timeSweeps([&] { lattice->monteCarloSweep(); }, sweeps);
+    printRate("Replica (pseudo)", REPLICAS * numIndices * sweeps, seconds);
+    delete lattice;
+
+    // k-body Hamiltonians sweep with cached term signs by default
+    if (!pairwise) {
+        lattice = chooseLattice(shape, h, t, 0, 1, PSEUDO);
+        lattice->setTermSigns(false);
+        seconds = timeSweeps([&] { lattice->monteCarloSweep(); }, sweeps);
+        printRate("Replica (no cache)", REPLICAS * numIndices * sweeps,
+                  seconds);
+
+        lattice->setLocalFields(true);
+        seconds = timeSweeps([&] { lattice->monteCarloSweep(); }, sweeps);
+        printRate("Replica (fields)", REPLICAS * numIndices * sweeps,
+                  seconds);
+        delete lattice;
+    }
+
+    lattice = chooseLattice(shape, h, t, 0, 1, PSEUDO);
+    lattice->setPackedSpins(true);
+    seconds = timeSweeps([&] { lattice->monteCarloSweep(); }, sweeps);
+    printRate("Replica (packed)", REPLICAS * numIndices * sweeps, seconds);
+    delete lattice;
+
+    // An n-fold way update covers a sweep of time however few flips it makes
+    lattice = chooseLattice(shape, h, t, 0, 1, PSEUDO);
+    lattice->setNFoldTemperature(2 * t);
+    seconds = timeSweeps([&] { lattice->monteCarloSweep(); }, sweeps);
+    printRate("Replica (n-fold)", REPLICAS * numIndices * sweeps, seconds);
+    delete lattice;
+
+    lattice = chooseLattice(shape, h, t, 0, 1, DEMON);
+    seconds = timeSweeps([&] { lattice->monteCarloSweep(); }, sweeps);
+    printRate("Replica (demon)", REPLICAS * numIndices * sweeps, seconds);
+    std::cout << "Demon temperature:\t"
+              << lattice->getConfigs()[0][0]->getDemonTemperature()
+              << std::endl;
+    delete lattice;
+
+    lattice = chooseLattice(shape, h, t, 0, 1, COLORED);
+    seconds = timeSweeps([&] { lattice->monteCarloSweep(); }, sweeps);
+    printRate("Replica (colored)", REPLICAS * numIndices * sweeps, seconds);
+    delete lattice;
+
+    // Wolff updates flip about as many indices as a sweep visits
+    if (pairwise) {
+        lattice = chooseLattice(shape, h, t, 0, 1, WOLFF);
+        seconds = timeSweeps([&] { lattice->monteCarloSweep(); }, sweeps);
+        printRate("Replica (Wolff)", REPLICAS * numIndices * sweeps, seconds);
+        delete lattice;
+
+        lattice = chooseLattice(shape, h, t, 0, 1, SWENDSEN_WANG);
+        seconds = timeSweeps([&] { lattice->monteCarloSweep(); }, sweeps);
+        printRate("Replica (Swendsen-Wang)", REPLICAS * numIndices * sweeps,
+                  seconds);
+        delete lattice;
+    }
+
+    // The arena pays off with many temperatures, so compare at that size
+    lattice = chooseLattice(shape, h, t, 0, ARENA_TEMPERATURES, ALL);
+    seconds = timeSweeps([&] { lattice->monteCarloSweep(); }, sweeps);
+    printRate("Replica (all)",
+              ARENA_TEMPERATURES * REPLICAS * numIndices * sweeps, seconds);
+    delete lattice;
+
+    lattice = chooseLattice(shape, h, t, 0, ARENA_TEMPERATURES, VECTORIZED);
+    seconds = timeSweeps([&] { lattice->monteCarloSweep(); }, sweeps);
+    printRate("Arena (vectorized)",
+              ARENA_TEMPERATURES * REPLICAS * numIndices * sweeps, seconds);
+    delete lattice;
+
+    // Temperatures below the middle of the range take Houdayer moves. The
+    // measurement pass of a simulation shares the allocation window, after
+    // one pass has sized its accumulators.
+    lattice = chooseLattice(shape, h, t, t / ICA_TEMPERATURES,
+                            ICA_TEMPERATURES, PSEUDO);
+    SimulatedLattice simulated(lattice, argv[1], 0, 1, 0, true);
+    for (uint i = 0; i < WARMUP_SWEEPS; ++i) {
+        lattice->ICA();
+    }
+    simulated.runUpdates(1);
+    size_t warm = allocations;
+    seconds = timeSweeps([&] { lattice->ICA(); }, sweeps);
+    printRate("ICA", ICA_TEMPERATURES * REPLICAS * numIndices * sweeps,
+              seconds);
+    simulated.runUpdates(sweeps / SKIP + 1);
+    std::cout << "ICA and measurement allocations after warm-up:\t"
+              << allocations - warm << std::endl;
+
+    MultiSpinLattice multiSpin(chooseLattice(shape, h, t, 0, 1, MULTISPIN));
+    seconds = timeSweeps([&] { multiSpin.monteCarloSweep(); }, sweeps);
+    printRate("Multi-spin", LANES * numIndices * sweeps, seconds);
+
+    std::cout << std::endl;
+}
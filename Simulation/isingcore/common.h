@@ -16,6 +16,8 @@ typedef std::vector<cvector> cvector2;
 typedef std::vector<int> ivector;
 typedef std::vector<ivector> ivector2;
 typedef std::vector<ivector2> ivector3;
+typedef std::vector<float> fvector;
+typedef std::vector<uint64_t> wvector;
 typedef std::vector<double> dvector;
 typedef std::vector<dvector> dvector2;
 typedef std::vector<cdouble> cdvector;
@@ -39,8 +41,24 @@ const double E = 2.71828182845904523536;
 const double PI = 3.14159265358979323846;
 const double KB = 1.38064852;
 enum { PLUS = 0, MINUS = 1 };
-enum { ALL = 'a', PSEUDO = 'p', RANDOM = 'r' };
-enum { RECTANGLE = 'r', SQUARE = 's', TRIANGLE = 't', STRIANGLE = 'v' };
+enum {
+    ALL = 'a',
+    PSEUDO = 'p',
+    RANDOM = 'r',
+    MULTISPIN = 'm',
+    COLORED = 'c',
+    VECTORIZED = 'v',
+    WOLFF = 'w',
+    SWENDSEN_WANG = 's',
+    DEMON = 'd'
+};
+enum {
+    RECTANGLE = 'r',
+    SQUARE = 's',
+    TRIANGLE = 't',
+    STRIANGLE = 'v',
+    DENSE = 'd'
+};
 
 #if defined(WIN32) || defined(_WIN32) || \
     defined(__WIN32) && !defined(__CYGWIN__)
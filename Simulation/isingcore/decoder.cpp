@@ -0,0 +1,133 @@
+#include <atomic>
+#include <climits>
+#include <iterator>
+#include <thread>
+#include "decoder.h"
+
+using namespace ising;
+
+Decoder::Decoder(const Hamiltonian& h, char shape, double t, double dt,
+                 uint n, char mode, uint sweeps, uint restarts)
+    : hamiltonian(h),
+      shape(shape),
+      minT(t),
+      dT(dt),
+      numT(n),
+      mode(mode),
+      sweeps(sweeps),
+      restarts(restarts),
+      threads(1) {
+    // Instance signs are given per line of the Hamiltonian file
+    if (h.getNumTerms() != h.getNumInputTerms()) {
+        std::cout << "DECODING NEEDS A HAMILTONIAN WITHOUT REPEATED OR ZERO "
+                  << "TERMS! Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    if (restarts == 0 || restarts > 256) {
+        std::cout << "DECODING NEEDS 1 TO 256 ANNEALS PER CLASS! "
+                  << "Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    Lattice* lattice = chooseLattice(shape, hamiltonian, t, dt, n, mode);
+    findTwists(*lattice);
+    delete lattice;
+}
+
+void Decoder::findTwists(const Lattice& lattice) {
+    twists.assign(1, ivector());
+
+    ivector colCut = lattice.findSeam(1);
+    ivector rowCut = lattice.findSeam(0);
+
+    if (colCut.empty() || rowCut.empty()) {
+        return;
+    }
+
+    // A term crossing both cuts is flipped twice in class 3
+    ivector bothCuts;
+    std::set_symmetric_difference(colCut.begin(), colCut.end(),
+                                  rowCut.begin(), rowCut.end(),
+                                  std::back_inserter(bothCuts));
+
+    twists.push_back(colCut);
+    twists.push_back(rowCut);
+    twists.push_back(bothCuts);
+}
+
+// Anneals one instance of one class from the highest temperature of the
+// lattice to the lowest, restarting from new random spins, and returns the
+// lowest energy seen after any sweep
+int Decoder::anneal(Lattice& lattice, Replica& replica, const cvector& signs,
+                    uint instance, uint twist) {
+    cvector twisted = signs;
+    for (auto& k : twists[twist]) {
+        twisted[k] *= -1;
+    }
+
+    lattice.setCouplingSigns(twisted);
+
+    uint64_t runSeed = RandomGenerator::getRunSeed();
+    int best = INT_MAX;
+
+    for (uint r = 0; r < restarts; ++r) {
+        replica.seed(runSeed,
+                     RandomGenerator::makeStream(instance, twist, r));
+
+        for (int n = numT - 1; n >= 0; --n) {
+            replica.setTemperature(minT + n * dT);
+
+            for (uint s = 0; s < sweeps; ++s) {
+                replica.update();
+                best = std::min(best, replica.getTotalEnergy());
+            }
+        }
+    }
+
+    return best;
+}
+
+// Threads take instances in turn, each through its own copy of the
+// lattice whose signs are rewritten for every class
+void Decoder::decode(const std::vector<cvector>& instances) {
+    uint numInstances = instances.size();
+    ivector bestClasses(numInstances);
+    ivector bestEnergies(numInstances);
+    std::atomic<uint> next(0);
+
+    auto work = [&]() {
+        std::unique_ptr<Lattice> lattice(
+            chooseLattice(shape, hamiltonian, minT, dT, numT, mode));
+        Replica replica(lattice->getProperties(), 0);
+
+        for (uint i = next++; i < numInstances; i = next++) {
+            bestEnergies[i] = INT_MAX;
+
+            for (uint c = 0; c < twists.size(); ++c) {
+                int energy = anneal(*lattice, replica, instances[i], i, c);
+
+                if (energy < bestEnergies[i]) {
+                    bestEnergies[i] = energy;
+                    bestClasses[i] = c;
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (uint k = 0; k < std::min(threads, numInstances); ++k) {
+        workers.emplace_back(work);
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    classes.clear();
+    energies.clear();
+    for (uint i = 0; i < numInstances; ++i) {
+        classes[i] = bestClasses[i];
+        energies[i] = bestEnergies[i];
+    }
+}
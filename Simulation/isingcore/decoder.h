@@ -0,0 +1,48 @@
+#ifndef DECODER_H_
+#define DECODER_H_
+
+#include "isinghelpers.h"
+
+namespace ising {
+// Decodes error instances of a code mapped onto an Ising model. Every
+// instance is a pattern of coupling signs on the shared topology of the
+// Hamiltonian. A correction class is the instance with the couplings
+// crossing a cut around the periodic lattice flipped: class 1 for the cut
+// between the last and first column, 2 for the cut between the last and
+// first row, 3 for both. The lowest annealed energy picks the class. Without
+// locations only class 0 is annealed, which yields ground energies alone.
+class Decoder {
+   public:
+    Decoder(const Hamiltonian& h, char shape, double t, double dt, uint n,
+            char mode, uint sweeps, uint restarts);
+
+    uint getNumClasses() const { return twists.size(); }
+    void setThreads(uint n) { threads = std::max(n, 1U); }
+    void decode(const std::vector<cvector>& instances);
+
+    // Results by instance
+    const dmap& getClasses() const { return classes; }
+    const dmap& getEnergies() const { return energies; }
+
+   private:
+    void findTwists(const Lattice& lattice);
+    int anneal(Lattice& lattice, Replica& replica, const cvector& signs,
+               uint instance, uint twist);
+
+    const Hamiltonian hamiltonian;
+    const char shape;
+    const double minT;
+    const double dT;
+    const uint numT;
+    const char mode;
+    uint sweeps;
+    uint restarts;
+    uint threads;
+    // Terms whose couplings each class flips
+    ivector2 twists;
+    dmap classes;
+    dmap energies;
+};
+}
+
+#endif /* DECODER_H_ */
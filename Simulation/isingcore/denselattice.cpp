@@ -0,0 +1,314 @@
+#include "denselattice.h"
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+using namespace ising;
+
+// Row updates of each coupling storage, through the selected kernels
+static void addScaledRow(int* field, const int8_t* row, int scale, uint n) {
+    getKernels().addScaledInt8(field, row, scale, n);
+}
+
+static void addScaledRow(int* field, const int16_t* row, int scale, uint n) {
+    getKernels().addScaledInt16(field, row, scale, n);
+}
+
+static void addScaledRow(float* field, const float* row, float scale,
+                         uint n) {
+    getKernels().addScaledFloats(field, row, scale, n);
+}
+
+DenseCouplings ising::readDenseCouplings(std::ifstream& file) {
+    DenseCouplings dense;
+    std::string line;
+    char shape = '\0';
+    long n = -1;
+
+    if (isalpha(file.peek())) {
+        getline(file, line);
+        std::stringstream stream(line);
+        stream >> shape;
+
+        if (stream.peek() == ',') {
+            stream.ignore();
+            stream >> n;
+        }
+    }
+
+    if (shape != DENSE || n <= 0) {
+        std::cout << "INVALID DENSE HAMILTONIAN HEADER! Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    dense.numIndices = n;
+    dense.couplings.assign(n * n, 0);
+
+    double num;
+    for (long i = 0; i < n - 1; ++i) {
+        long j = i + 1;
+
+        if (getline(file, line)) {
+            std::istringstream lineStream(line);
+
+            while (j < n && lineStream >> num) {
+                dense.couplings[i * n + j] = num;
+                dense.couplings[j * n + i] = num;
+                dense.maxCoupling =
+                    std::max(dense.maxCoupling, (float)std::abs(num));
+                dense.integral &= num == std::floor(num);
+                ++j;
+
+                if (lineStream.peek() == ',') {
+                    lineStream.ignore();
+                }
+            }
+        }
+
+        if (j != n) {
+            std::cout << "INCOMPLETE DENSE HAMILTONIAN ROW! Exiting...\n\n";
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    return dense;
+}
+
+template <class J>
+DenseLattice<J>::DenseLattice(const DenseCouplings& dense, double t,
+                              double dt, uint n, uint r)
+    : numIndices(dense.numIndices), numT(n), replicas(r) {
+    if (std::is_integral<J>::value) {
+        if (!dense.integral) {
+            std::cout << "REAL COUPLINGS NEED FLOAT STORAGE! Exiting...\n\n";
+            exit(EXIT_FAILURE);
+        }
+
+        if (dense.maxCoupling > std::numeric_limits<J>::max()) {
+            std::cout << "DENSE COUPLING TOO LARGE FOR STORAGE! "
+                         "Exiting...\n\n";
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    couplings.assign(dense.couplings.begin(), dense.couplings.end());
+
+    for (uint i = 0; i < numT; ++i) {
+        temperatures.push_back(t + i * dt);
+    }
+
+    generateProbabilities();
+    thresholds.resize(numIndices);
+
+    states.resize(numT * replicas);
+    for (uint s = 0; s < states.size(); ++s) {
+        slots.push_back(s);
+        initState(states[s]);
+    }
+}
+
+// Acceptance tables for integer couplings, indexed by minus the index energy
+// of an uphill flip, as for replicas
+template <class J>
+void DenseLattice<J>::generateProbabilities() {
+    if (!std::is_integral<J>::value) {
+        return;
+    }
+
+    int maxIndexEnergy = 0;
+    for (uint i = 0; i < numIndices; ++i) {
+        const J* row = couplings.data() + (size_t)i * numIndices;
+        int energy = 0;
+
+        for (uint j = 0; j < numIndices; ++j) {
+            energy += std::abs((int)row[j]);
+        }
+
+        maxIndexEnergy = std::max(maxIndexEnergy, energy);
+    }
+
+    if (maxIndexEnergy > MAX_TABLE_ENERGY) {
+        return;
+    }
+
+    probabilities.assign(numT, dvector(maxIndexEnergy + 1));
+    for (uint t = 0; t < numT; ++t) {
+        for (int e = 0; e <= maxIndexEnergy; ++e) {
+            probabilities[t][e] = pow(E, (-1 / temperatures[t]) * (2 * e));
+        }
+    }
+}
+
+template <class J>
+void DenseLattice<J>::initState(State& state) {
+    state.spins.resize(numIndices);
+    state.spinSum = 0;
+    state.sweeps = 0;
+
+    for (auto& s : state.spins) {
+        s = (state.gen.randInt() % 2 == 0) ? 1 : -1;
+        state.spinSum += s;
+    }
+
+    initFields(state);
+}
+
+// Fields are summed at Energy precision before being stored, so a refresh
+// also clears the drift of float fields
+template <class J>
+void DenseLattice<J>::initFields(State& state) {
+    const uint n = numIndices;
+    std::vector<Energy> sums(n, 0);
+    Energy* sum = sums.data();
+
+    for (uint i = 0; i < n; ++i) {
+        const int s = state.spins[i];
+        const J* row = couplings.data() + (size_t)i * n;
+
+        for (uint j = 0; j < n; ++j) {
+            sum[j] += s * (Energy)row[j];
+        }
+    }
+
+    // Every pair is counted from both ends
+    Energy energy = 0;
+    state.fields.resize(n);
+    for (uint i = 0; i < n; ++i) {
+        state.fields[i] = (Field)sum[i];
+        energy -= state.spins[i] * sum[i];
+    }
+    state.totalEnergy = energy / 2;
+}
+
+// States are reseeded from the slot they start in, as replicas are
+template <class J>
+void DenseLattice<J>::seed(uint trial) {
+    uint64_t runSeed = RandomGenerator::getRunSeed();
+
+    for (uint t = 0; t < numT; ++t) {
+        for (uint r = 0; r < replicas; ++r) {
+            uint s = t * replicas + r;
+            slots[s] = s;
+            states[s].gen.setStream(runSeed,
+                                    RandomGenerator::makeStream(trial, t, r));
+            initState(states[s]);
+        }
+    }
+}
+
+template <class J>
+void DenseLattice<J>::flip(State& state, uint index, Field energy) {
+    const uint n = numIndices;
+    char& s = state.spins[index];
+    Field* field = state.fields.data();
+
+    s = -s;
+    state.totalEnergy -= 2 * (Energy)energy;
+    state.spinSum += 2 * s;
+
+    // The diagonal is zero, so the flipped field is left as is
+    addScaledRow(field, couplings.data() + (size_t)index * n, (Field)(2 * s),
+                 n);
+}
+
+// Uniforms are only drawn for uphill flips
+template <class J>
+void DenseLattice<J>::sweepTable(State& state, uint t) {
+    const double* p = probabilities.empty() ? nullptr : probabilities[t].data();
+    const double beta = 1 / temperatures[t];
+    const char* s = state.spins.data();
+    const Field* field = state.fields.data();
+
+    for (uint i = 0; i < numIndices; ++i) {
+        Field energy = -s[i] * field[i];
+
+        if (energy >= 0 ||
+            (p ? p[-(int)energy] : std::exp(2 * beta * energy)) >
+                state.gen.randFloatCO()) {
+            flip(state, i, energy);
+        }
+    }
+}
+
+// Metropolis with one uniform per index, drawn and turned into an energy
+// threshold for the whole sweep at once: a flip of index energy e is
+// accepted with probability exp(2e / T) when e >= T / 2 * log(1 - u), and
+// always when e >= 0. The logarithms vectorize; the sweep itself is only
+// comparisons and row updates.
+template <class J>
+void DenseLattice<J>::sweepThresholds(State& state, uint t) {
+    const uint n = numIndices;
+    const float scale = temperatures[t] / 2;
+    float* threshold = thresholds.data();
+
+    state.gen.fillFloatCO(threshold, n);
+    getKernels().findThresholds(threshold, scale, n);
+
+    const char* s = state.spins.data();
+    const Field* field = state.fields.data();
+    for (uint i = 0; i < n; ++i) {
+        Field energy = -s[i] * field[i];
+
+        if (energy >= threshold[i]) {
+            flip(state, i, energy);
+        }
+    }
+
+    if (++state.sweeps % DENSE_REFRESH_SWEEPS == 0) {
+        initFields(state);
+    }
+}
+
+template <class J>
+void DenseLattice<J>::monteCarloSweep() {
+    for (uint t = 0; t < numT; ++t) {
+        for (uint r = 0; r < replicas; ++r) {
+            State& state = states[getSlot(t, r)];
+
+            if (std::is_integral<J>::value) {
+                sweepTable(state, t);
+            } else {
+                sweepThresholds(state, t);
+            }
+        }
+    }
+}
+
+template <class J>
+void DenseLattice<J>::parallelTemperingUpdate() {
+    for (uint t = 0; t + 1 < numT; ++t) {
+        for (uint r = 0; r < replicas; ++r) {
+            int& a = slots[t * replicas + r];
+            int& b = slots[(t + 1) * replicas + r];
+            double dEnergy = states[a].totalEnergy - states[b].totalEnergy;
+            double dBoltzmann = 1 / temperatures[t] - 1 / temperatures[t + 1];
+            double exponent = dEnergy * dBoltzmann;
+
+            if (exponent >= 0 ||
+                pow(E, exponent) > states[a].gen.randFloatCO()) {
+                std::swap(a, b);
+            }
+        }
+    }
+}
+
+template <class J>
+typename DenseLattice<J>::Energy DenseLattice<J>::findTotalEnergy(
+    uint t, uint r) const {
+    const cvector& s = getSpins(t, r);
+    Energy energy = 0;
+
+    for (uint i = 0; i < numIndices; ++i) {
+        const J* row = couplings.data() + (size_t)i * numIndices;
+        for (uint j = i + 1; j < numIndices; ++j) {
+            energy -= (Energy)row[j] * s[i] * s[j];
+        }
+    }
+
+    return energy;
+}
+
+template class ising::DenseLattice<int8_t>;
+template class ising::DenseLattice<int16_t>;
+template class ising::DenseLattice<float>;
@@ -0,0 +1,123 @@
+#ifndef DENSELATTICE_H_
+#define DENSELATTICE_H_
+
+#include <fstream>
+#include <type_traits>
+#include "common.h"
+#include "kernels.h"
+
+namespace ising {
+// Couplings of a fully connected Hamiltonian as a symmetric row-major matrix
+// with a zero diagonal, so that row i holds J(i, j) for every j. Couplings
+// are kept as read; integral is false when any of them is not an integer.
+struct DenseCouplings {
+    uint numIndices = 0;
+    fvector couplings;
+    float maxCoupling = 0;
+    bool integral = true;
+
+    float get(uint i, uint j) const {
+        return couplings[(size_t)i * numIndices + j];
+    }
+};
+
+// Reads a dense input file: a "d,N" header followed by the upper triangle,
+// line i holding the couplings J(i, i + 1), ..., J(i, N - 1)
+DenseCouplings readDenseCouplings(std::ifstream& file);
+
+// Integer couplings keep exact int fields, bounded by the sum of one row,
+// and 64-bit total energies, which sum over all N^2 / 2 pairs. Real
+// couplings accumulate fields in float, with total energies kept in double.
+template <class J, bool = std::is_integral<J>::value>
+struct DenseTypes {
+    typedef int Field;
+    typedef int64_t Energy;
+};
+
+template <class J>
+struct DenseTypes<J, false> {
+    typedef float Field;
+    typedef double Energy;
+};
+
+// Sweeps between recomputing float fields and energies from the couplings,
+// which bounds the rounding drift of the incremental updates
+const uint DENSE_REFRESH_SWEEPS = 64;
+// Largest index energy given an acceptance table; integer couplings beyond
+// it evaluate the exponential per flip
+const int MAX_TABLE_ENERGY = 1 << 16;
+
+// Replicas of an all-to-all Hamiltonian with the couplings stored as one
+// contiguous matrix of J. Every state keeps the local field of all indices,
+// so a flip attempt is a single lookup, and an accepted flip of index i adds
+// twice row i of J to the fields in one unit-stride loop. int8_t couplings
+// keep a thousands-of-spins matrix small enough to stream at full bandwidth,
+// and float couplings run Gaussian spin glasses.
+// Parallel tempering permutes states between temperatures, as the arena does.
+template <class J>
+class DenseLattice {
+   public:
+    typedef typename DenseTypes<J>::Field Field;
+    typedef typename DenseTypes<J>::Energy Energy;
+
+    DenseLattice(const DenseCouplings& couplings, double t, double dt, uint n,
+                 uint replicas);
+
+    uint getNumIndices() const { return numIndices; }
+    uint getNumTemperatures() const { return numT; }
+    double getTemperature(uint t) const { return temperatures[t]; }
+    Energy getTotalEnergy(uint t, uint r) const {
+        return states[getSlot(t, r)].totalEnergy;
+    }
+    int getSpinSum(uint t, uint r) const {
+        return states[getSlot(t, r)].spinSum;
+    }
+    const cvector& getSpins(uint t, uint r) const {
+        return states[getSlot(t, r)].spins;
+    }
+
+    void seed(uint trial);
+    void monteCarloSweep();
+    void parallelTemperingUpdate();
+    void update() {
+        monteCarloSweep();
+        parallelTemperingUpdate();
+    }
+
+    Energy findTotalEnergy(uint t, uint r) const;
+
+   private:
+    struct State {
+        cvector spins;
+        std::vector<Field> fields;
+        Energy totalEnergy = 0;
+        int spinSum = 0;
+        uint sweeps = 0;
+        RandomGenerator gen;
+    };
+
+    uint getSlot(uint t, uint r) const { return slots[t * replicas + r]; }
+    void generateProbabilities();
+    void initState(State& state);
+    void initFields(State& state);
+    void flip(State& state, uint index, Field energy);
+    void sweepTable(State& state, uint t);
+    void sweepThresholds(State& state, uint t);
+
+    uint numIndices;
+    uint numT;
+    uint replicas;
+    std::vector<J> couplings;
+    dvector temperatures;
+    dvector2 probabilities;
+    fvector thresholds;
+    std::vector<State> states;
+    ivector slots;
+};
+
+typedef DenseLattice<int8_t> DenseLattice8;
+typedef DenseLattice<int16_t> DenseLattice16;
+typedef DenseLattice<float> DenseLatticeF;
+}
+
+#endif /* DENSELATTICE_H_ */
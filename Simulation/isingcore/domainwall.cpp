@@ -0,0 +1,192 @@
+#include "domainwall.h"
+
+using namespace ising;
+
+DomainWall::DomainWall(Lattice* lattice, uint preupdates, uint updates)
+    : lattice(lattice),
+      prop(lattice->getProperties()),
+      preupdates(preupdates),
+      updates(updates) {
+    seam = lattice->findSeam(1);
+
+    if (seam.empty()) {
+        std::cout << "DOMAIN WALLS NEED A PERIODIC LATTICE WITH ROWS AND "
+                  << "COLUMNS! Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    if (updates == 0) {
+        std::cout << "DOMAIN WALLS NEED AT LEAST ONE UPDATE! Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    Replica::checkReplicaMode(prop.mode, "DOMAIN WALLS");
+
+    periodicSigns.assign(prop.hFunction.size(), 1);
+    antiperiodicSigns = periodicSigns;
+    for (auto& k : seam) {
+        antiperiodicSigns[k] = -1;
+    }
+
+    double maxT = prop.minT + (prop.numT - 1) * prop.dT;
+    for (uint i = 0; i < prop.numT; ++i) {
+        ladder.push_back(prop.minT + i * prop.dT);
+    }
+    for (uint k = WALL_WARMUP_STEPS - 1; k > 0; --k) {
+        ladder.push_back(maxT * WALL_WARMUP_STEPS / k);
+    }
+
+    for (uint i = 0; i < ladder.size(); ++i) {
+        periodic.push_back(std::make_shared<Replica>(prop, 0));
+        antiperiodic.push_back(std::make_shared<Replica>(prop, 0));
+    }
+
+    seed(0);
+}
+
+// Replicas are seeded under the couplings they are swept with, so their
+// cached energies hold. Warm-up replicas lie above the lattice's range.
+void DomainWall::seed(uint trial) {
+    uint64_t runSeed = RandomGenerator::getRunSeed();
+    gen.setStream(runSeed,
+                  RandomGenerator::makeStream(trial, 0, DOMAIN_WALL_STREAM));
+
+    lattice->setCouplingSigns(periodicSigns);
+    for (uint i = 0; i < ladder.size(); ++i) {
+        periodic[i]->setTemperatureUnchecked(ladder[i]);
+        periodic[i]->seed(runSeed, RandomGenerator::makeStream(trial, i, 0));
+    }
+
+    lattice->setCouplingSigns(antiperiodicSigns);
+    for (uint i = 0; i < ladder.size(); ++i) {
+        antiperiodic[i]->setTemperatureUnchecked(ladder[i]);
+        antiperiodic[i]->seed(runSeed,
+                              RandomGenerator::makeStream(trial, i, 1));
+    }
+}
+
+// Sweeps one variant under its couplings, then offers each neighboring
+// pair of temperatures an exchange
+void DomainWall::sweep(replicavector& replicas, const cvector& signs) {
+    lattice->setCouplingSigns(signs);
+
+    for (auto& replica : replicas) {
+        replica->update();
+    }
+
+    for (uint i = 0; i + 1 < replicas.size(); ++i) {
+        double t1 = replicas[i]->getTemperature();
+        double t2 = replicas[i + 1]->getTemperature();
+        double dEnergy = replicas[i]->getTotalEnergy() -
+                         replicas[i + 1]->getTotalEnergy();
+        double exponent = dEnergy * (1 / t1 - 1 / t2);
+
+        if (exponent >= 0 || exp(exponent) > gen.randFloatCO()) {
+            replicas[i]->setTemperatureUnchecked(t2);
+            replicas[i + 1]->setTemperatureUnchecked(t1);
+            replicas[i].swap(replicas[i + 1]);
+        }
+    }
+}
+
+void DomainWall::run() {
+    uint blocks = std::min(WALL_BLOCKS, updates);
+    dvector2 differenceSums(blocks, dvector(ladder.size(), 0));
+    ivector blockUpdates(blocks, 0);
+    dvector periodicSums(prop.numT, 0);
+    dvector antiperiodicSums(prop.numT, 0);
+
+    for (uint k = 0; k < preupdates + updates; ++k) {
+        sweep(periodic, periodicSigns);
+        sweep(antiperiodic, antiperiodicSigns);
+
+        if (k < preupdates) {
+            continue;
+        }
+
+        uint b = (uint64_t)(k - preupdates) * blocks / updates;
+        ++blockUpdates[b];
+
+        for (uint i = 0; i < ladder.size(); ++i) {
+            double periodicEnergy = periodic[i]->getTotalEnergy();
+            double antiperiodicEnergy = antiperiodic[i]->getTotalEnergy();
+            differenceSums[b][i] += antiperiodicEnergy - periodicEnergy;
+
+            if (i < prop.numT) {
+                periodicSums[i] += periodicEnergy;
+                antiperiodicSums[i] += antiperiodicEnergy;
+            }
+        }
+    }
+
+    for (uint i = 0; i < prop.numT; ++i) {
+        temperatures[i] = ladder[i];
+        periodicEnergies[i] = periodicSums[i] / updates / prop.numIndices;
+        antiperiodicEnergies[i] =
+            antiperiodicSums[i] / updates / prop.numIndices;
+    }
+
+    recordFreeEnergies(differenceSums, blockUpdates);
+}
+
+// Trapezoids in 1/T from infinite temperature, where both variants have
+// zero mean energy, down the ladder. Entry i integrates to ladder[i].
+dvector DomainWall::integrate(const dvector& differences) const {
+    dvector integral(ladder.size());
+    double lastBeta = 0;
+    double lastDifference = 0;
+    double betaF = 0;
+
+    for (int i = ladder.size() - 1; i >= 0; --i) {
+        double beta = 1 / ladder[i];
+        betaF += (beta - lastBeta) * (differences[i] + lastDifference) / 2;
+        integral[i] = betaF;
+        lastBeta = beta;
+        lastDifference = differences[i];
+    }
+
+    return integral;
+}
+
+// The integral of all updates is the result; the spread of the integrals of
+// the blocks gives its standard error
+void DomainWall::recordFreeEnergies(const dvector2& differenceSums,
+                                    const ivector& blockUpdates) {
+    uint blocks = blockUpdates.size();
+    dvector differences(ladder.size(), 0);
+    dvector2 blockIntegrals;
+
+    for (uint b = 0; b < blocks; ++b) {
+        dvector blockDifferences(ladder.size());
+
+        for (uint i = 0; i < ladder.size(); ++i) {
+            differences[i] += differenceSums[b][i] / updates;
+            blockDifferences[i] = differenceSums[b][i] / blockUpdates[b];
+        }
+
+        blockIntegrals.push_back(integrate(blockDifferences));
+    }
+
+    dvector integral = integrate(differences);
+
+    for (uint i = 0; i < prop.numT; ++i) {
+        double error = 0;
+
+        if (blocks > 1) {
+            double mean = 0;
+            for (auto& blockIntegral : blockIntegrals) {
+                mean += blockIntegral[i] / blocks;
+            }
+
+            for (auto& blockIntegral : blockIntegrals) {
+                error += pow(blockIntegral[i] - mean, 2);
+            }
+
+            error = sqrt(error / (blocks * (blocks - 1)));
+        }
+
+        betaFreeEnergyDifferences[i] = integral[i];
+        betaFreeEnergyErrors[i] = error;
+        freeEnergyDifferences[i] = integral[i] * ladder[i];
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef DOMAINWALL_H_
+#define DOMAINWALL_H_
+
+#include "lattices.h"
+
+namespace ising {
+// Equal steps in 1/T taken from infinite temperature to the highest
+// temperature of the lattice, each but the first held by its own replicas
+const uint WALL_WARMUP_STEPS = 8;
+// Blocks of measured updates whose integrals give the error of the result
+const uint WALL_BLOCKS = 16;
+
+// Periodic and antiperiodic variants of one disorder realization, run in
+// lockstep on a single lattice. The antiperiodic variant flips the
+// couplings of the seam between the last and first column. Only the
+// couplings of the lattice are rewritten before each variant is swept, so
+// both share every other table. Each variant holds one replica per
+// temperature, exchanged by parallel tempering, and one per warm-up step
+// above the lattice's temperatures. The domain-wall free energy F_AP - F_P
+// follows by thermodynamic integration of the difference of mean energies
+// in 1/T, from infinite temperature where it vanishes. Its error is the
+// standard error of the same integral taken over blocks of updates.
+class DomainWall {
+   public:
+    DomainWall(Lattice* lattice, uint preupdates, uint updates);
+    DomainWall(const DomainWall&) = delete;
+    DomainWall& operator=(const DomainWall&) = delete;
+    ~DomainWall() { delete lattice; }
+
+    Lattice* getLattice() const { return lattice; }
+    uint getSeamSize() const { return seam.size(); }
+    void seed(uint trial);
+    void run();
+
+    // Results by temperature, indexed as the lattice's temperatures
+    const dmap& getTemperatures() const { return temperatures; }
+    const dmap& getPeriodicEnergies() const { return periodicEnergies; }
+    const dmap& getAntiperiodicEnergies() const {
+        return antiperiodicEnergies;
+    }
+    const dmap& getFreeEnergyDifferences() const {
+        return freeEnergyDifferences;
+    }
+    // Delta(F / T), with the standard errors of the same
+    const dmap& getBetaFreeEnergyDifferences() const {
+        return betaFreeEnergyDifferences;
+    }
+    const dmap& getBetaFreeEnergyErrors() const {
+        return betaFreeEnergyErrors;
+    }
+
+   private:
+    void sweep(replicavector& replicas, const cvector& signs);
+    dvector integrate(const dvector& differences) const;
+    void recordFreeEnergies(const dvector2& differenceSums,
+                            const ivector& blockUpdates);
+
+    Lattice* lattice;
+    const LatticeProperties& prop;
+    uint preupdates;
+    uint updates;
+    ivector seam;
+    cvector periodicSigns;
+    cvector antiperiodicSigns;
+    // The lattice's temperatures, then the warm-up temperatures, rising
+    dvector ladder;
+    // Replica i is at ladder[i]
+    replicavector periodic;
+    replicavector antiperiodic;
+    dmap temperatures;
+    dmap periodicEnergies;
+    dmap antiperiodicEnergies;
+    dmap freeEnergyDifferences;
+    dmap betaFreeEnergyDifferences;
+    dmap betaFreeEnergyErrors;
+    RandomGenerator gen;
+};
+}
+
+#endif /* DOMAINWALL_H_ */
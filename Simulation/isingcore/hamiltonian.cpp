@@ -2,17 +2,19 @@
 
 using namespace ising;
 
-ivector2 ising::importHamiltonianVector(std::ifstream &file) {
-    ivector2 hamiltonianVector;
+template <class T>
+std::vector<std::vector<T>> ising::importHamiltonianVector(
+    std::ifstream &file) {
+    std::vector<std::vector<T>> hamiltonianVector;
     std::string line;
-    int num;
+    T num;
 
     while (isalpha(file.peek())) {
         file.ignore(256, '\n');
     }
 
     while (getline(file, line)) {
-        ivector interaction;
+        std::vector<T> interaction;
         std::istringstream lineStream(line);
 
         while (lineStream >> num) {
@@ -23,34 +25,138 @@ ivector2 ising::importHamiltonianVector(std::ifstream &file) {
             }
         }
 
+        if (!lineStream.eof() && std::is_integral<T>::value) {
+            std::cout << "NON-INTEGER HAMILTONIAN ENTRY! Real couplings only "
+                         "run in isingsimulation. Exiting...\n\n";
+            exit(EXIT_FAILURE);
+        } else if (!lineStream.eof()) {
+            std::cout << "INVALID HAMILTONIAN ENTRY! Exiting...\n\n";
+            exit(EXIT_FAILURE);
+        }
+
         hamiltonianVector.push_back(interaction);
     }
 
     return hamiltonianVector;
 }
 
+template ivector2 ising::importHamiltonianVector<int>(std::ifstream &file);
+template dvector2 ising::importHamiltonianVector<double>(std::ifstream &file);
+
 Hamiltonian::Hamiltonian(ivector2 h, char s, int r, int c)
     : hamiltonian(h), shape(s), rows(r), cols(c) {
+    generateAll();
+}
+
+Hamiltonian::Hamiltonian(const dvector2 &h, char s, int r, int c)
+    : shape(s), rows(r), cols(c) {
+    bool integral = true;
+    for (auto &term : h) {
+        integral &= term.empty() || (term[0] == std::floor(term[0]) &&
+                                     std::abs(term[0]) <= INT32_MAX);
+    }
+
+    for (auto &term : h) {
+        hamiltonian.emplace_back(term.begin(), term.end());
+
+        if (!integral && !term.empty()) {
+            hamiltonian.back()[0] = term[0] < 0 ? -1 : 1;
+            couplings.push_back(term[0]);
+        } else if (!integral) {
+            couplings.push_back(0);
+        }
+    }
+
+    generateAll();
+}
+
+void Hamiltonian::generateAll() {
     generateIndices();
+    canonicalize();
     generateLocations();
     generateLocalTerms();
     generateIndInteractions();
 }
 
 void Hamiltonian::generateIndices() {
-    ivector::iterator it;
+    std::set<int> unique;
 
     for (auto &interaction : hamiltonian) {
-        for (it = interaction.begin() + 1; it != interaction.end(); ++it) {
-            if (std::find(indices.begin(), indices.end(), *it) ==
-                indices.end()) {
-                indices.push_back(*it);
+        unique.insert(interaction.begin() + 1, interaction.end());
+    }
+
+    indices.assign(unique.begin(), unique.end());
+    numIndices = (int)indices.size();
+}
+
+// Sorts the indices of every term, merges equal terms by summing their
+// couplings and drops terms left with zero coupling. Terms keep the order in
+// which they first appear. As spins square to one, repeated indices of a term
+// cancel in pairs, and terms left without indices only shift the energy by a
+// constant and are dropped as well. Indices are found beforehand so that
+// none is lost along with its terms. Real couplings are summed alongside,
+// and the signs kept in the terms follow their sums.
+void Hamiltonian::canonicalize() {
+    std::map<ivector, uint> positions;
+    ivector2 terms;
+    dvector sums;
+
+    numInputTerms = hamiltonian.size();
+    numMergedTerms = 0;
+
+    for (uint t = 0; t < hamiltonian.size(); ++t) {
+        ivector &h = hamiltonian[t];
+
+        if (h.size() < 2) {
+            continue;
+        }
+
+        ivector sorted(h.begin() + 1, h.end());
+        std::sort(sorted.begin(), sorted.end());
+
+        ivector term;
+        for (auto &i : sorted) {
+            if (!term.empty() && term.back() == i) {
+                term.pop_back();
+            } else {
+                term.push_back(i);
             }
         }
+
+        if (term.empty()) {
+            continue;
+        }
+
+        double coupling = couplings.empty() ? h[0] : couplings[t];
+        auto found = positions.find(term);
+        if (found != positions.end()) {
+            terms[found->second][0] += h[0];
+            sums[found->second] += coupling;
+            ++numMergedTerms;
+            continue;
+        }
+
+        positions[term] = terms.size();
+        term.insert(term.begin(), h[0]);
+        terms.push_back(term);
+        sums.push_back(coupling);
     }
 
-    std::sort(indices.begin(), indices.end());
-    numIndices = (int)indices.size();
+    bool real = hasRealCouplings();
+    hamiltonian.clear();
+    couplings.clear();
+    for (uint k = 0; k < terms.size(); ++k) {
+        if (sums[k] == 0) {
+            continue;
+        }
+
+        if (real) {
+            terms[k][0] = sums[k] < 0 ? -1 : 1;
+            couplings.push_back(sums[k]);
+        }
+
+        hamiltonian.push_back(terms[k]);
+    }
 }
 
 void Hamiltonian::generateLocations() {
@@ -118,9 +224,16 @@ void Hamiltonian::generateIndInteractions() {
 void Hamiltonian::printHamiltonian() const {
     std::cout << "Printing Hamiltonian:" << std::endl;
 
-    for (auto &interaction : hamiltonian) {
-        for (auto &i : interaction) {
-            std::cout << i << " ";
+    for (uint k = 0; k < hamiltonian.size(); ++k) {
+        if (hasRealCouplings()) {
+            std::cout << couplings[k] << " ";
+        } else {
+            std::cout << hamiltonian[k][0] << " ";
+        }
+
+        for (auto it = hamiltonian[k].begin() + 1; it != hamiltonian[k].end();
+             ++it) {
+            std::cout << *it << " ";
         }
 
         std::cout << std::endl;
@@ -129,6 +242,19 @@ void Hamiltonian::printHamiltonian() const {
     std::cout << std::endl;
 }
 
+// Only reports when canonicalization changed the input
+void Hamiltonian::printReduction() const {
+    if (getNumTerms() == numInputTerms) {
+        return;
+    }
+
+    std::cout << "Canonical Hamiltonian: " << getNumTerms() << " of "
+              << numInputTerms << " terms kept (" << numMergedTerms
+              << " merged, "
+              << numInputTerms - numMergedTerms - getNumTerms()
+              << " dropped)" << std::endl;
+}
+
 void Hamiltonian::printIndices() const {
     std::cout << "Printing indices:" << std::endl;
 
@@ -2,21 +2,37 @@
 #define HAMILTONIAN_H_
 
 #include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include "common.h"
 
 namespace ising {
-ivector2 importHamiltonianVector(std::ifstream &file);
+// Reads the terms of a sparse input file, one "J,i,j,..." per line, with
+// entries of type T. Reading int exits at an entry that is not an integer;
+// reading double also takes real couplings.
+template <class T = int>
+std::vector<std::vector<T>> importHamiltonianVector(std::ifstream &file);
 
 class Hamiltonian {
    public:
     Hamiltonian(ivector2 h, char s = '\0', int r = -1, int c = -1);
+    // Terms as read by importHamiltonianVector<double>. When every coupling
+    // is an integer this is the Hamiltonian above; otherwise the first entry
+    // of each term only keeps the sign of its coupling, and the couplings
+    // themselves are kept in getCouplings(), one per term.
+    Hamiltonian(const dvector2 &h, char s = '\0', int r = -1, int c = -1);
     ~Hamiltonian() {}
 
     const ivector2 getHamiltonian() const { return hamiltonian; }
+    bool hasRealCouplings() const { return !couplings.empty(); }
+    const dvector &getCouplings() const { return couplings; }
+    uint getNumTerms() const { return hamiltonian.size(); }
+    uint getNumInputTerms() const { return numInputTerms; }
+    uint getNumMergedTerms() const { return numMergedTerms; }
     uint getNumIndices() const { return numIndices; }
     const ivector getIndices() const { return indices; }
     const i2arraymap getLocations() const { return locations; }
@@ -30,18 +46,24 @@ class Hamiltonian {
     int getCols() const { return cols; }
 
     void printHamiltonian() const;
+    void printReduction() const;
     void printIndices() const;
     void printLocations() const;
     void printLocalTerms() const;
     void printIndInteractions() const;
 
    private:
+    void generateAll();
     void generateIndices();
+    void canonicalize();
     void generateLocations();
     void generateLocalTerms();
     void generateIndInteractions();
 
     ivector2 hamiltonian;
+    dvector couplings;
+    uint numInputTerms;
+    uint numMergedTerms;
     uint numIndices;
     ivector indices;
     i2arraymap locations;
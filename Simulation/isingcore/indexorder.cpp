@@ -0,0 +1,120 @@
+#include "indexorder.h"
+#include <algorithm>
+#include <deque>
+
+using namespace ising;
+
+// Distance along the Hilbert curve filling a side x side grid, side being a
+// power of two
+static uint64_t findHilbertKey(uint64_t side, uint64_t x, uint64_t y) {
+    uint64_t key = 0;
+
+    for (uint64_t s = side / 2; s > 0; s /= 2) {
+        uint64_t rx = (x & s) > 0;
+        uint64_t ry = (y & s) > 0;
+        key += s * s * ((3 * rx) ^ ry);
+
+        // Rotate the quadrant so the curve stays continuous
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+
+            std::swap(x, y);
+        }
+    }
+
+    return key;
+}
+
+ivector ising::findHilbertOrder(const ivector& indices,
+                                const i2arraymap& locations) {
+    uint64_t side = 1;
+    for (auto& loc : locations) {
+        while (side <= (uint64_t)std::max(loc.second[0], loc.second[1])) {
+            side *= 2;
+        }
+    }
+
+    std::vector<std::pair<uint64_t, int>> keys;
+    for (auto& i : indices) {
+        const i2array& loc = locations.at(i);
+        keys.emplace_back(findHilbertKey(side, loc[0], loc[1]), i);
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    ivector order;
+    for (auto& key : keys) {
+        order.push_back(key.second);
+    }
+
+    return order;
+}
+
+// Breadth-first from a least connected unvisited index of each component,
+// visiting neighbors by increasing degree, then reversed
+ivector ising::findRCMOrder(const ivector& indices,
+                            const ivectormap& localTerms) {
+    uint n = indices.size();
+    auto position = [&indices](int label) {
+        return std::lower_bound(indices.begin(), indices.end(), label) -
+               indices.begin();
+    };
+
+    ivector2 neighbors(n);
+    for (auto& terms : localTerms) {
+        ivector& local = neighbors[position(terms.first)];
+
+        for (auto& j : terms.second) {
+            local.push_back(position(j));
+        }
+
+        std::sort(local.begin(), local.end());
+        local.erase(std::unique(local.begin(), local.end()), local.end());
+    }
+
+    auto byDegree = [&neighbors](int a, int b) {
+        return neighbors[a].size() < neighbors[b].size() ||
+               (neighbors[a].size() == neighbors[b].size() && a < b);
+    };
+
+    ivector starts(n);
+    for (uint i = 0; i < n; ++i) {
+        starts[i] = i;
+    }
+    std::sort(starts.begin(), starts.end(), byDegree);
+
+    std::vector<bool> visited(n, false);
+    ivector order;
+    ivector next;
+    for (auto& start : starts) {
+        if (visited[start]) {
+            continue;
+        }
+
+        visited[start] = true;
+        std::deque<int> queue = {start};
+
+        while (!queue.empty()) {
+            int i = queue.front();
+            queue.pop_front();
+            order.push_back(indices[i]);
+
+            next.clear();
+            for (auto& j : neighbors[i]) {
+                if (!visited[j]) {
+                    visited[j] = true;
+                    next.push_back(j);
+                }
+            }
+
+            std::sort(next.begin(), next.end(), byDegree);
+            queue.insert(queue.end(), next.begin(), next.end());
+        }
+    }
+
+    std::reverse(order.begin(), order.end());
+    return order;
+}
@@ -0,0 +1,25 @@
+#ifndef INDEXORDER_H_
+#define INDEXORDER_H_
+
+#include "common.h"
+
+namespace ising {
+// Orders in which mapsToSequences numbers the indices of a Hamiltonian.
+// NATURAL keeps the sorted original labels. HILBERT walks a Hilbert curve
+// through the index locations and RCM numbers the interaction graph by
+// reverse Cuthill-McKee, both so that interacting indices sit close in
+// memory. LOCALITY picks HILBERT when locations are known and RCM otherwise.
+enum {
+    NATURAL_ORDER = 'n',
+    LOCALITY_ORDER = 'l',
+    HILBERT_ORDER = 'h',
+    RCM_ORDER = 'r'
+};
+
+// Both return the original labels of indices, which must be sorted, in
+// their new order
+ivector findHilbertOrder(const ivector& indices, const i2arraymap& locations);
+ivector findRCMOrder(const ivector& indices, const ivectormap& localTerms);
+}
+
+#endif /* INDEXORDER_H_ */
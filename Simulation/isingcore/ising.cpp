@@ -3,6 +3,7 @@
 using namespace ising;
 
 int main(int argc, char *argv[]) {
+    readOptionFlags(argc, argv);
     std::string filename = receiveHamiltonianFile(argc, argv);
     std::ifstream file(filename);
 
@@ -14,6 +15,7 @@ int main(int argc, char *argv[]) {
 
     char shape;
     Hamiltonian hamiltonian = readHamiltonian(file, shape);
+    hamiltonian.printReduction();
 
     file.close();
 
@@ -32,8 +34,9 @@ int main(int argc, char *argv[]) {
     } else {
         std::cout << "Enter temperature (K): ";
         std::cin >> temperature;
-        std::cout
-            << "Enter update mode (a - all, p - pseudorandom, r - random): ";
+        std::cout << "Enter update mode (a - all, p - pseudorandom, "
+                  << "r - random, c - colored, v - vectorized, w - Wolff, "
+                  << "s - Swendsen-Wang, d - demon): ";
         std::cin >> mode;
     }
 
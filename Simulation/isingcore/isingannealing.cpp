@@ -0,0 +1,112 @@
+#include "isingannealing.h"
+
+using namespace ising;
+
+int main(int argc, char *argv[]) {
+    std::string inFilename;
+    double t, dt;
+    int n, population, sweeps;
+    char mode;
+    uint64_t seed;
+
+    readOptionFlags(argc, argv);
+    receiveAnnealingInput(argc, argv, inFilename, t, dt, n, population,
+                          sweeps, mode, seed);
+    RandomGenerator::setRunSeed(seed);
+    std::cout << "Run seed: " << seed << "\n";
+    std::cout << "Kernels: " << getKernels().name << "\n";
+    manageAnnealing(inFilename, t, dt, n, population, sweeps, mode);
+}
+
+void ising::manageAnnealing(const std::string &inFilename, const double t,
+                            const double dt, const int n,
+                            const int population, const int sweeps,
+                            const char mode) {
+    std::ifstream file(inFilename);
+
+    if (!file) {
+        std::cout << "Invalid file name. " << inFilename
+                  << " does not exist!\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    char shape;
+    Hamiltonian hamiltonian = readHamiltonian(file, shape);
+    hamiltonian.printReduction();
+    file.close();
+
+    PopulationAnnealing annealing(
+        chooseLattice(shape, hamiltonian, t, dt, n, mode), population, sweeps);
+    annealing.setThreads(std::thread::hardware_concurrency());
+    annealing.run();
+
+    std::cout << "Final population: " << annealing.getPopulation()
+              << " replicas in " << annealing.getFamilies().at(0)
+              << " families\n";
+
+    const dmap &temperatures = annealing.getTemperatures();
+    std::string outF = getOutFilename(inFilename, "pa_free_energies");
+    std::string outE = getOutFilename(inFilename, "pa_energies");
+    std::string outC = getOutFilename(inFilename, "pa_specific_heats");
+    std::string outMag = getOutFilename(inFilename, "pa_magnetizations");
+    std::string outBC = getOutFilename(inFilename, "pa_binder_cumulants");
+    std::string outFam = getOutFilename(inFilename, "pa_families");
+
+    writeOutput(outF, temperatures, annealing.getFreeEnergies());
+    writeOutput(outE, temperatures, annealing.getEnergies());
+    writeOutput(outC, temperatures, annealing.getSpecificHeats());
+    writeOutput(outMag, temperatures, annealing.getMagnetizations());
+    writeOutput(outBC, temperatures, annealing.getBinderCumulants());
+    writeOutput(outFam, temperatures, annealing.getFamilies());
+}
+
+void ising::receiveAnnealingInput(int argc, char *argv[],
+                                  std::string &filename, double &t,
+                                  double &dt, int &n, int &population,
+                                  int &sweeps, char &mode, uint64_t &seed) {
+    seed = RandomGenerator::getRunSeed();
+
+    if (argc == 1) {
+        std::cout << "Enter Hamiltonian input file: ";
+        std::cin >> filename;
+        std::cout << "Enter minimum temperature (K): ";
+        std::cin >> t;
+        std::cout << "Enter change in temperature between steps (K): ";
+        std::cin >> dt;
+        std::cout << "Enter total number of temperatures: ";
+        std::cin >> n;
+        std::cout << "Enter population size: ";
+        std::cin >> population;
+        std::cout << "Enter number of sweeps per temperature: ";
+        std::cin >> sweeps;
+        std::cout << "Enter update mode (a - all, p - pseudorandom, "
+                  << "r - random, c - colored, v - vectorized, w - Wolff, "
+                  << "s - Swendsen-Wang): ";
+        std::cin >> mode;
+        std::cout << "Enter run seed (0 - random): ";
+        std::cin >> seed;
+        if (seed == 0) {
+            seed = RandomGenerator::getRunSeed();
+        }
+    } else if (argc == 8 || argc == 9) {
+        filename = argv[1];
+        t = atof(argv[2]);
+        dt = atof(argv[3]);
+        n = atoi(argv[4]);
+        population = atoi(argv[5]);
+        sweeps = atoi(argv[6]);
+        mode = (argv[7])[0];
+        if (argc == 9) {
+            seed = strtoull(argv[8], nullptr, 10);
+        }
+    } else {
+        std::cout << "Usage: " << argv[0] << " filename(std::string) ";
+        std::cout << "min_temperature(float) change_temperature(float) ";
+        std::cout << "num_temperatures(int) population(int) sweeps(int) ";
+        std::cout << "mode(char) [seed(uint64)] ";
+        std::cout << "[--isa=scalar|generic|avx2|avx512] [--order=n|l|h|r] ";
+        std::cout << "[--nfold=temperature(float)] [--threads=n(uint)]";
+        std::cout << std::endl << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
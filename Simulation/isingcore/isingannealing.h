@@ -0,0 +1,17 @@
+#ifndef ISINGANNEALING_H_
+#define ISINGANNEALING_H_
+
+#include <thread>
+#include "isinghelpers.h"
+#include "populationannealing.h"
+
+namespace ising {
+void receiveAnnealingInput(int argc, char *argv[], std::string &filename,
+                           double &t, double &dt, int &n, int &population,
+                           int &sweeps, char &mode, uint64_t &seed);
+void manageAnnealing(const std::string &inFilename, const double t,
+                     const double dt, const int n, const int population,
+                     const int sweeps, const char mode);
+}
+
+#endif /* ISINGANNEALING_H_ */
@@ -0,0 +1,116 @@
+#include "isingdensity.h"
+
+using namespace ising;
+
+int main(int argc, char *argv[]) {
+    std::string inFilename;
+    double t, dt;
+    int n, windows, walkers;
+    uint64_t seed;
+
+    readOptionFlags(argc, argv);
+    receiveDensityInput(argc, argv, inFilename, t, dt, n, windows, walkers,
+                        seed);
+    RandomGenerator::setRunSeed(seed);
+    std::cout << "Run seed: " << seed << "\n";
+    manageDensity(inFilename, t, dt, n, windows, walkers);
+}
+
+void ising::manageDensity(const std::string &inFilename, const double t,
+                          const double dt, const int n, const int windows,
+                          const int walkers) {
+    std::ifstream file(inFilename);
+
+    if (!file) {
+        std::cout << "Invalid file name. " << inFilename
+                  << " does not exist!\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    char shape;
+    Hamiltonian hamiltonian = readHamiltonian(file, shape);
+    hamiltonian.printReduction();
+    file.close();
+
+    WangLandau wangLandau(chooseLattice(shape, hamiltonian, t, dt, n, PSEUDO),
+                          windows, walkers);
+    wangLandau.run();
+
+    for (uint k = 0; k + 1 < wangLandau.getNumWindows(); ++k) {
+        std::cout << "Exchange rate between windows " << k << " and " << k + 1
+                  << ": " << wangLandau.getExchangeRate(k) << "\n";
+    }
+
+    dmap energies;
+    for (auto &g : wangLandau.getLogDensity()) {
+        energies[g.first] = g.first;
+    }
+
+    dmap temperatures, avgEnergies, specificHeats, magnetizations,
+        binderCumulants;
+    for (int i = 0; i < n; ++i) {
+        double temperature = t + i * dt;
+
+        temperatures[i] = temperature;
+        avgEnergies[i] = wangLandau.getEnergy(temperature);
+        specificHeats[i] = wangLandau.getSpecificHeat(temperature);
+        magnetizations[i] = wangLandau.getMagnetization(temperature);
+        binderCumulants[i] = wangLandau.getBinderCumulant(temperature);
+    }
+
+    std::string outDOS = getOutFilename(inFilename, "density_of_states");
+    std::string outE = getOutFilename(inFilename, "wl_energies");
+    std::string outC = getOutFilename(inFilename, "wl_specific_heats");
+    std::string outMag = getOutFilename(inFilename, "wl_magnetizations");
+    std::string outBC = getOutFilename(inFilename, "wl_binder_cumulants");
+
+    writeOutput(outDOS, energies, wangLandau.getLogDensity(), "energy");
+    writeOutput(outE, temperatures, avgEnergies);
+    writeOutput(outC, temperatures, specificHeats);
+    writeOutput(outMag, temperatures, magnetizations);
+    writeOutput(outBC, temperatures, binderCumulants);
+}
+
+void ising::receiveDensityInput(int argc, char *argv[], std::string &filename,
+                                double &t, double &dt, int &n, int &windows,
+                                int &walkers, uint64_t &seed) {
+    seed = RandomGenerator::getRunSeed();
+
+    if (argc == 1) {
+        std::cout << "Enter Hamiltonian input file: ";
+        std::cin >> filename;
+        std::cout << "Enter minimum temperature (K): ";
+        std::cin >> t;
+        std::cout << "Enter change in temperature between outputs (K): ";
+        std::cin >> dt;
+        std::cout << "Enter total number of temperatures: ";
+        std::cin >> n;
+        std::cout << "Enter number of energy windows: ";
+        std::cin >> windows;
+        std::cout << "Enter number of walkers per window: ";
+        std::cin >> walkers;
+        std::cout << "Enter run seed (0 - random): ";
+        std::cin >> seed;
+        if (seed == 0) {
+            seed = RandomGenerator::getRunSeed();
+        }
+    } else if (argc == 7 || argc == 8) {
+        filename = argv[1];
+        t = atof(argv[2]);
+        dt = atof(argv[3]);
+        n = atoi(argv[4]);
+        windows = atoi(argv[5]);
+        walkers = atoi(argv[6]);
+        if (argc == 8) {
+            seed = strtoull(argv[7], nullptr, 10);
+        }
+    } else {
+        std::cout << "Usage: " << argv[0] << " filename(std::string) ";
+        std::cout << "min_temperature(float) change_temperature(float) ";
+        std::cout << "num_temperatures(int) windows(int) walkers(int) ";
+        std::cout << "[seed(uint64)] [--isa=scalar|generic|avx2|avx512] ";
+        std::cout << "[--order=n|l|h|r]";
+        std::cout << std::endl << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
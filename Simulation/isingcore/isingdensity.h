@@ -0,0 +1,16 @@
+#ifndef ISINGDENSITY_H_
+#define ISINGDENSITY_H_
+
+#include "isinghelpers.h"
+#include "wanglandau.h"
+
+namespace ising {
+void receiveDensityInput(int argc, char *argv[], std::string &filename,
+                         double &t, double &dt, int &n, int &windows,
+                         int &walkers, uint64_t &seed);
+void manageDensity(const std::string &inFilename, const double t,
+                   const double dt, const int n, const int windows,
+                   const int walkers);
+}
+
+#endif /* ISINGDENSITY_H_ */
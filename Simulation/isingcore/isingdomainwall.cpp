@@ -0,0 +1,110 @@
+#include "isingdomainwall.h"
+
+using namespace ising;
+
+int main(int argc, char *argv[]) {
+    std::string inFilename;
+    double t, dt;
+    int n, preupdates, updates;
+    char mode;
+    uint64_t seed;
+
+    readOptionFlags(argc, argv);
+    receiveDomainWallInput(argc, argv, inFilename, t, dt, n, preupdates,
+                           updates, mode, seed);
+    RandomGenerator::setRunSeed(seed);
+    std::cout << "Run seed: " << seed << "\n";
+    std::cout << "Kernels: " << getKernels().name << "\n";
+    manageDomainWall(inFilename, t, dt, n, preupdates, updates, mode);
+}
+
+void ising::manageDomainWall(const std::string &inFilename, const double t,
+                             const double dt, const int n,
+                             const int preupdates, const int updates,
+                             const char mode) {
+    std::ifstream file(inFilename);
+
+    if (!file) {
+        std::cout << "Invalid file name. " << inFilename
+                  << " does not exist!\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    char shape;
+    Hamiltonian hamiltonian = readHamiltonian(file, shape);
+    hamiltonian.printReduction();
+    file.close();
+
+    DomainWall domainWall(chooseLattice(shape, hamiltonian, t, dt, n, mode),
+                          preupdates, updates);
+    std::cout << "Seam of " << domainWall.getSeamSize() << " couplings\n";
+    domainWall.run();
+
+    const dmap &temperatures = domainWall.getTemperatures();
+    std::string outDF = getOutFilename(inFilename, "domain_wall_free_energies");
+    std::string outP = getOutFilename(inFilename, "dw_periodic_energies");
+    std::string outAP = getOutFilename(inFilename, "dw_antiperiodic_energies");
+
+    std::string outBF =
+        getOutFilename(inFilename, "domain_wall_beta_free_energies");
+    std::string outBFE =
+        getOutFilename(inFilename, "domain_wall_beta_free_energy_errors");
+
+    writeOutput(outDF, temperatures, domainWall.getFreeEnergyDifferences());
+    writeOutput(outBF, temperatures,
+                domainWall.getBetaFreeEnergyDifferences());
+    writeOutput(outBFE, temperatures, domainWall.getBetaFreeEnergyErrors());
+    writeOutput(outP, temperatures, domainWall.getPeriodicEnergies());
+    writeOutput(outAP, temperatures, domainWall.getAntiperiodicEnergies());
+}
+
+void ising::receiveDomainWallInput(int argc, char *argv[],
+                                   std::string &filename, double &t,
+                                   double &dt, int &n, int &preupdates,
+                                   int &updates, char &mode, uint64_t &seed) {
+    seed = RandomGenerator::getRunSeed();
+
+    if (argc == 1) {
+        std::cout << "Enter Hamiltonian input file: ";
+        std::cin >> filename;
+        std::cout << "Enter minimum temperature (K): ";
+        std::cin >> t;
+        std::cout << "Enter change in temperature between lattices (K): ";
+        std::cin >> dt;
+        std::cout << "Enter total number of lattices: ";
+        std::cin >> n;
+        std::cout << "Enter number of thermalizing updates: ";
+        std::cin >> preupdates;
+        std::cout << "Enter number of measured updates: ";
+        std::cin >> updates;
+        std::cout << "Enter update mode (a - all, p - pseudorandom, "
+                  << "r - random, c - colored, v - vectorized, w - Wolff, "
+                  << "s - Swendsen-Wang, d - demon): ";
+        std::cin >> mode;
+        std::cout << "Enter run seed (0 - random): ";
+        std::cin >> seed;
+        if (seed == 0) {
+            seed = RandomGenerator::getRunSeed();
+        }
+    } else if (argc == 8 || argc == 9) {
+        filename = argv[1];
+        t = atof(argv[2]);
+        dt = atof(argv[3]);
+        n = atoi(argv[4]);
+        preupdates = atoi(argv[5]);
+        updates = atoi(argv[6]);
+        mode = (argv[7])[0];
+        if (argc == 9) {
+            seed = strtoull(argv[8], nullptr, 10);
+        }
+    } else {
+        std::cout << "Usage: " << argv[0] << " filename(std::string) ";
+        std::cout << "min_temperature(float) change_temperature(float) ";
+        std::cout << "num_lattices(int) preupdates(int) updates(int) ";
+        std::cout << "mode(char) [seed(uint64)] ";
+        std::cout << "[--isa=scalar|generic|avx2|avx512] [--order=n|l|h|r] ";
+        std::cout << "[--nfold=temperature(float)] [--threads=n(uint)]";
+        std::cout << std::endl << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef ISINGDOMAINWALL_H_
+#define ISINGDOMAINWALL_H_
+
+#include "domainwall.h"
+#include "isinghelpers.h"
+
+namespace ising {
+void receiveDomainWallInput(int argc, char *argv[], std::string &filename,
+                            double &t, double &dt, int &n, int &preupdates,
+                            int &updates, char &mode, uint64_t &seed);
+void manageDomainWall(const std::string &inFilename, const double t,
+                      const double dt, const int n, const int preupdates,
+                      const int updates, const char mode);
+}
+
+#endif /* ISINGDOMAINWALL_H_ */
@@ -8,7 +8,8 @@ static const std::string SLASH = "/";
 
 using namespace ising;
 
-Hamiltonian ising::readHamiltonian(std::ifstream& file, char& shape) {
+Hamiltonian ising::readHamiltonian(std::ifstream& file, char& shape,
+                                   bool real) {
     shape = '\0';
     int rows = -1;
     int cols = -1;
@@ -34,6 +35,18 @@ Hamiltonian ising::readHamiltonian(std::ifstream& file, char& shape) {
         fields[2] >> cols;
     }
 
+    // Only Simulation dispatches these, to the dense engine
+    if (shape == DENSE) {
+        std::cout << "DENSE HAMILTONIANS ONLY RUN IN isingsimulation! "
+                     "Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    if (real) {
+        return Hamiltonian(importHamiltonianVector<double>(file), shape, rows,
+                           cols);
+    }
+
     return Hamiltonian(importHamiltonianVector(file), shape, rows, cols);
 }
 
@@ -41,6 +54,15 @@ Lattice* ising::chooseLattice(char shape, const Hamiltonian& h, double t,
                               double dt, uint n, char m) {
     Lattice* lattice;
 
+    // The arena and multi-spin engines sweep without consulting replicas,
+    // so they would silently ignore the n-fold temperature
+    if ((m == VECTORIZED || m == MULTISPIN) &&
+        Lattice::getDefaultNFoldTemperature() > 0) {
+        std::cout << "N-FOLD UPDATES DO NOT RUN IN VECTORIZED OR MULTI-SPIN "
+                     "MODE! Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
     switch (shape) {
         case RECTANGLE:
             lattice = new RectangularLattice(h, t, dt, n, m);
@@ -61,6 +83,36 @@ Lattice* ising::chooseLattice(char shape, const Hamiltonian& h, double t,
     return lattice;
 }
 
+void ising::readOptionFlags(int& argc, char* argv[]) {
+    const std::string isaFlag = "--isa=";
+    const std::string orderFlag = "--order=";
+    const std::string nFoldFlag = "--nfold=";
+    const std::string threadsFlag = "--threads=";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg.compare(0, isaFlag.size(), isaFlag) == 0) {
+            selectKernels(findIsa(arg.substr(isaFlag.size())));
+        } else if (arg.compare(0, orderFlag.size(), orderFlag) == 0 &&
+                   arg.size() == orderFlag.size() + 1) {
+            Lattice::setDefaultIndexOrder(arg.back());
+        } else if (arg.compare(0, nFoldFlag.size(), nFoldFlag) == 0) {
+            Lattice::setDefaultNFoldTemperature(
+                atof(arg.substr(nFoldFlag.size()).c_str()));
+        } else if (arg.compare(0, threadsFlag.size(), threadsFlag) == 0) {
+            Lattice::setDefaultSweepThreads(
+                atoi(arg.substr(threadsFlag.size()).c_str()));
+        } else {
+            continue;
+        }
+
+        std::copy(argv + i + 1, argv + argc + 1, argv + i);
+        --argc;
+        --i;
+    }
+}
+
 std::string ising::getOutFilename(const std::string& inFilename,
                                   const std::string& newDir) {
     fs::path outFilename(inFilename);
@@ -92,13 +144,13 @@ std::string ising::getOutFilename(const std::string& inFilename,
 }
 
 void ising::writeOutput(const std::string& filename, const dmap& temperatures,
-                        const dmap& results) {
+                        const dmap& results, const std::string& key) {
     fs::path directory(filename);
     directory.remove_filename();
     fs::create_directory(directory);
 
     std::ofstream file(filename.c_str());
-    file << "temperature,result\n";
+    file << key << ",result\n";
 
     ivector indices;
     for (auto& t : temperatures) {
@@ -113,6 +165,6 @@ void ising::writeOutput(const std::string& filename, const dmap& temperatures,
 
     file.close();
 
-    std::cout << "Recorded results by temperature in " << filename;
+    std::cout << "Recorded results by " << key << " in " << filename;
     std::cout << std::endl;
 }
@@ -10,7 +10,10 @@ namespace fs = std::experimental::filesystem;
 namespace ising {
 const int MAX_FILENAME_SIZE = 255;
 
-Hamiltonian readHamiltonian(std::ifstream& file, char& shape);
+// Real couplings are only read when real is set, by the engines that run
+// them; otherwise entries that are not integers exit
+Hamiltonian readHamiltonian(std::ifstream& file, char& shape,
+                            bool real = false);
 Lattice* chooseLattice(char shape, const Hamiltonian& hamiltonian, double t,
                        double dt, uint n, char m);
 std::string getOutFilename(const std::string& inFilename,
@@ -18,8 +21,15 @@ std::string getOutFilename(const std::string& inFilename,
 std::string getOutFilename(const std::string& inFilename,
                            const std::string& oldDir,
                            const std::string& newDir);
+// Handles the optional flags --isa=NAME, forcing the kernel instruction
+// set, --order=CHAR, setting the index order of new lattices,
+// --nfold=TEMPERATURE, below which their replicas update by the n-fold way
+// (not in VECTORIZED or MULTISPIN mode), and --threads=N, the number of
+// threads sharing each of their sweeps.
+// Flags are removed so the remaining arguments keep their positions.
+void readOptionFlags(int& argc, char* argv[]);
 void writeOutput(const std::string& filename, const dmap& temperatures,
-                 const dmap& results);
+                 const dmap& results, const std::string& key = "temperature");
 }
 
 #endif /* ISINGHELPERS_H_ */
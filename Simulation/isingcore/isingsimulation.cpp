@@ -1,8 +1,10 @@
+#include <chrono>
 #include "isingsimulation.h"
 
 using namespace ising;
 
 std::mutex SimulatedLattice::file_mutex;
+std::mutex SimulatedMultiSpinLattice::file_mutex;
 std::mutex Simulation::file_mutex;
 std::mutex Simulation::trial_mutex;
 std::mutex Simulation::avgMag_mutex;
@@ -16,10 +18,107 @@ int main(int argc, char *argv[]) {
     double t, dt;
     int n, updates, trials;
     char mode;
+    uint64_t seed;
 
+    std::string instancesFilename = receiveDecodeFlag(argc, argv);
+    readOptionFlags(argc, argv);
     receiveSimulationInput(argc, argv, inFilename, t, dt, n, updates, trials,
-                           mode);
-    manageSimulation(inFilename, t, dt, n, updates, trials, mode);
+                           mode, seed);
+    RandomGenerator::setRunSeed(seed);
+    std::cout << "Run seed: " << seed << "\n";
+    std::cout << "Kernels: " << getKernels().name << "\n";
+
+    if (instancesFilename.empty()) {
+        manageSimulation(inFilename, t, dt, n, updates, trials, mode);
+    } else {
+        manageDecoding(inFilename, instancesFilename, t, dt, n, updates,
+                       trials, mode);
+    }
+}
+
+std::string ising::receiveDecodeFlag(int &argc, char *argv[]) {
+    const std::string decodeFlag = "--decode=";
+    std::string filename;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg.compare(0, decodeFlag.size(), decodeFlag) != 0) {
+            continue;
+        }
+
+        filename = arg.substr(decodeFlag.size());
+        std::copy(argv + i + 1, argv + argc + 1, argv + i);
+        --argc;
+        --i;
+    }
+
+    return filename;
+}
+
+// Every line of the instances file holds one sign per line of the
+// Hamiltonian file. The temperatures form the annealing schedule, updates
+// are sweeps per temperature and trials are anneals per correction class.
+void ising::manageDecoding(const std::string &inFilename,
+                           const std::string &instancesFilename,
+                           const double t, const double dt, const int n,
+                           const int updates, const int trials,
+                           const char mode) {
+    std::ifstream file(inFilename);
+    std::ifstream instancesFile(instancesFilename);
+
+    if (!file || !instancesFile) {
+        std::cout << "Invalid file name. "
+                  << (file ? instancesFilename : inFilename)
+                  << " does not exist!\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    char shape;
+    Hamiltonian hamiltonian = readHamiltonian(file, shape);
+    hamiltonian.printReduction();
+    file.close();
+
+    std::vector<cvector> instances;
+    for (auto &values : importHamiltonianVector(instancesFile)) {
+        if (values.empty()) {
+            continue;
+        }
+
+        cvector signs;
+        for (auto &v : values) {
+            signs.push_back(v < 0 ? -1 : 1);
+        }
+
+        instances.push_back(signs);
+    }
+
+    instancesFile.close();
+
+    Decoder decoder(hamiltonian, shape, t, dt, n, mode, updates, trials);
+    decoder.setThreads(std::thread::hardware_concurrency());
+
+    auto start = std::chrono::steady_clock::now();
+    decoder.decode(instances);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << "Decoded " << instances.size() << " instances of "
+              << decoder.getNumClasses() << " classes in " << elapsed.count()
+              << " s: " << instances.size() / elapsed.count()
+              << " instances per second\n";
+
+    std::string outClass = getOutFilename(instancesFilename, "decodings");
+    std::string outEnergy =
+        getOutFilename(instancesFilename, "decoding_energies");
+
+    dmap numbers;
+    for (uint i = 0; i < instances.size(); ++i) {
+        numbers[i] = i;
+    }
+
+    writeOutput(outClass, numbers, decoder.getClasses(), "instance");
+    writeOutput(outEnergy, numbers, decoder.getEnergies(), "instance");
 }
 
 void ising::manageSimulation(const std::string &inFilename, const double t,
@@ -45,7 +144,9 @@ void ising::manageSimulation(const std::string &inFilename, const double t,
 void ising::receiveSimulationInput(int argc, char *argv[],
                                    std::string &filename, double &t, double &dt,
                                    int &n, int &updates, int &trials,
-                                   char &mode) {
+                                   char &mode, uint64_t &seed) {
+    seed = RandomGenerator::getRunSeed();
+
     if (argc == 1) {
         std::cout << "Enter Hamiltonian input file: ";
         std::cin >> filename;
@@ -59,10 +160,17 @@ void ising::receiveSimulationInput(int argc, char *argv[],
         std::cin >> updates;
         std::cout << "Enter number of trials: ";
         std::cin >> trials;
-        std::cout
-            << "Enter update mode (a - all, p - pseudorandom, r - random): ";
+        std::cout << "Enter update mode (a - all, p - pseudorandom, "
+                  << "r - random, c - colored, m - multi-spin, "
+                  << "v - vectorized, w - Wolff, s - Swendsen-Wang, "
+                  << "d - demon): ";
         std::cin >> mode;
-    } else if (argc == 8) {
+        std::cout << "Enter run seed (0 - random): ";
+        std::cin >> seed;
+        if (seed == 0) {
+            seed = RandomGenerator::getRunSeed();
+        }
+    } else if (argc == 8 || argc == 9) {
         filename = argv[1];
         t = atof(argv[2]);
         dt = atof(argv[3]);
@@ -70,10 +178,16 @@ void ising::receiveSimulationInput(int argc, char *argv[],
         updates = atoi(argv[5]);
         trials = atoi(argv[6]);
         mode = (argv[7])[0];
+        if (argc == 9) {
+            seed = strtoull(argv[8], nullptr, 10);
+        }
     } else {
         std::cout << "Usage: " << argv[0] << " filename(std::string) ";
         std::cout << "min_temperature(float) change_temperature(float) ";
-        std::cout << "num_lattices(int) updates(int) trials(int) mode(char)";
+        std::cout << "num_lattices(int) updates(int) trials(int) mode(char) ";
+        std::cout << "[seed(uint64)] [--isa=scalar|generic|avx2|avx512] ";
+        std::cout << "[--order=n|l|h|r] [--nfold=temperature(float)] ";
+        std::cout << "[--threads=n(uint)] [--decode=instances_file]";
         std::cout << std::endl << std::endl;
         exit(EXIT_FAILURE);
     }
@@ -2,12 +2,19 @@
 #define ISINGSIMULATION_H_
 
 #include <thread>
+#include "decoder.h"
 #include "simulation.h"
 
 namespace ising {
 void receiveSimulationInput(int argc, char *argv[], std::string &filename,
                             double &t, double &dt, int &n, int &updates,
-                            int &trials, char &mode);
+                            int &trials, char &mode, uint64_t &seed);
+// Removes the flag --decode=FILE and returns FILE, or an empty string
+std::string receiveDecodeFlag(int &argc, char *argv[]);
+void manageDecoding(const std::string &inFilename,
+                    const std::string &instancesFilename, const double t,
+                    const double dt, const int n, const int updates,
+                    const int trials, const char mode);
 void manageSimulation(const std::string &inFilename, const double t,
                       const double dt, const int n, const int updates,
                       const int trials, const char mode);
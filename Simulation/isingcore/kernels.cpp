@@ -0,0 +1,250 @@
+#include "kernels.h"
+#include <cmath>
+#include <iostream>
+
+using namespace ising;
+
+// Kernel bodies are written once and always inlined into a wrapper per Isa,
+// so each copy is vectorized with the instructions its wrapper targets
+#define KERNEL inline __attribute__((always_inline))
+
+namespace {
+template <class S, class T>
+KERNEL void addScaled(S* a, const T* b, S scale, uint n) {
+    for (uint i = 0; i < n; ++i) {
+        a[i] += scale * b[i];
+    }
+}
+
+KERNEL void multiplyChars(int* a, const char* b, uint n) {
+    for (uint i = 0; i < n; ++i) {
+        a[i] *= b[i];
+    }
+}
+
+KERNEL void addInts(int* a, const int* b, uint n) {
+    for (uint i = 0; i < n; ++i) {
+        a[i] += b[i];
+    }
+}
+
+KERNEL void findEnergies(int* e, const char* s, const int* f, uint n) {
+    for (uint i = 0; i < n; ++i) {
+        e[i] = -s[i] * f[i];
+    }
+}
+
+KERNEL void findThresholds(float* x, float scale, uint n) {
+    for (uint i = 0; i < n; ++i) {
+        x[i] = scale * std::log(1 - x[i]);
+    }
+}
+
+KERNEL int sumChars(const char* s, uint n) {
+    int sum = 0;
+
+    for (uint i = 0; i < n; ++i) {
+        sum += s[i];
+    }
+
+    return sum;
+}
+
+KERNEL uint popcount(const uint64_t* a, uint n) {
+    uint count = 0;
+
+    for (uint i = 0; i < n; ++i) {
+        count += __builtin_popcountll(a[i]);
+    }
+
+    return count;
+}
+
+KERNEL uint popcountAnd(const uint64_t* a, const uint64_t* b, uint n) {
+    uint count = 0;
+
+    for (uint i = 0; i < n; ++i) {
+        count += __builtin_popcountll(a[i] & b[i]);
+    }
+
+    return count;
+}
+
+KERNEL uint popcountXor(const uint64_t* a, const uint64_t* b, uint n) {
+    uint count = 0;
+
+    for (uint i = 0; i < n; ++i) {
+        count += __builtin_popcountll(a[i] ^ b[i]);
+    }
+
+    return count;
+}
+
+KERNEL uint countDifferentChars(const char* a, const char* b, uint n) {
+    uint count = 0;
+
+    for (uint i = 0; i < n; ++i) {
+        count += a[i] != b[i];
+    }
+
+    return count;
+}
+
+// Phases are read as interleaved real and imaginary parts
+KERNEL cdouble dotPhases(const double* x, const cdouble* phases, uint n) {
+    const double* p = reinterpret_cast<const double*>(phases);
+    double re = 0;
+    double im = 0;
+
+    for (uint i = 0; i < n; ++i) {
+        re += x[i] * p[2 * i];
+        im += x[i] * p[2 * i + 1];
+    }
+
+    return cdouble(re, im);
+}
+}
+
+#define DEFINE_KERNELS(NAMESPACE, ATTRIBUTES)                                 \
+    namespace {                                                               \
+    namespace NAMESPACE {                                                     \
+    ATTRIBUTES void addScaledChars(int* a, const char* b, int s, uint n) {    \
+        addScaled(a, b, s, n);                                                \
+    }                                                                         \
+    ATTRIBUTES void addScaledInt8(int* a, const int8_t* b, int s, uint n) {   \
+        addScaled(a, b, s, n);                                                \
+    }                                                                         \
+    ATTRIBUTES void addScaledInt16(int* a, const int16_t* b, int s, uint n) { \
+        addScaled(a, b, s, n);                                                \
+    }                                                                         \
+    ATTRIBUTES void addScaledFloats(float* a, const float* b, float s,        \
+                                    uint n) {                                 \
+        addScaled(a, b, s, n);                                                \
+    }                                                                         \
+    ATTRIBUTES void multiplyChars(int* a, const char* b, uint n) {            \
+        ::multiplyChars(a, b, n);                                             \
+    }                                                                         \
+    ATTRIBUTES void addInts(int* a, const int* b, uint n) {                   \
+        ::addInts(a, b, n);                                                   \
+    }                                                                         \
+    ATTRIBUTES void findEnergies(int* e, const char* s, const int* f,         \
+                                 uint n) {                                    \
+        ::findEnergies(e, s, f, n);                                           \
+    }                                                                         \
+    ATTRIBUTES void findThresholds(float* x, float scale, uint n) {           \
+        ::findThresholds(x, scale, n);                                        \
+    }                                                                         \
+    ATTRIBUTES int sumChars(const char* s, uint n) {                          \
+        return ::sumChars(s, n);                                              \
+    }                                                                         \
+    ATTRIBUTES uint popcount(const uint64_t* a, uint n) {                     \
+        return ::popcount(a, n);                                              \
+    }                                                                         \
+    ATTRIBUTES uint popcountAnd(const uint64_t* a, const uint64_t* b,         \
+                                uint n) {                                     \
+        return ::popcountAnd(a, b, n);                                        \
+    }                                                                         \
+    ATTRIBUTES uint popcountXor(const uint64_t* a, const uint64_t* b,         \
+                                uint n) {                                     \
+        return ::popcountXor(a, b, n);                                        \
+    }                                                                         \
+    ATTRIBUTES uint countDifferentChars(const char* a, const char* b,         \
+                                        uint n) {                             \
+        return ::countDifferentChars(a, b, n);                                \
+    }                                                                         \
+    ATTRIBUTES cdouble dotPhases(const double* x, const cdouble* p, uint n) { \
+        return ::dotPhases(x, p, n);                                          \
+    }                                                                         \
+    const Kernels kernels = {#NAMESPACE,     addScaledChars, addScaledInt8,   \
+                             addScaledInt16, addScaledFloats, multiplyChars,  \
+                             addInts,        findEnergies,   findThresholds,  \
+                             sumChars,       popcount,       popcountAnd,     \
+                             popcountXor,    countDifferentChars, dotPhases}; \
+    }                                                                         \
+    }
+
+DEFINE_KERNELS(scalar, __attribute__((optimize("no-tree-vectorize"))))
+DEFINE_KERNELS(generic, )
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AVX512_TARGET "avx512f,avx512bw,avx512vl,avx512vpopcntdq,popcnt"
+DEFINE_KERNELS(avx2, __attribute__((target("avx2,fma,popcnt"))))
+DEFINE_KERNELS(avx512, __attribute__((target(AVX512_TARGET))))
+#define X86_KERNELS
+#endif
+
+namespace {
+const Kernels* const kernelTable[NUM_ISAS] = {
+    &scalar::kernels,
+    &generic::kernels,
+#ifdef X86_KERNELS
+    &avx2::kernels,
+    &avx512::kernels,
+#else
+    &generic::kernels,
+    &generic::kernels,
+#endif
+};
+}
+
+// Generic until detection runs, in case a kernel is called during static
+// initialization
+const Kernels* ising::activeKernels = &generic::kernels;
+static const bool detected = (selectKernels(detectIsa()), true);
+
+Isa ising::detectIsa() {
+    for (int isa = NUM_ISAS - 1; isa > GENERIC; --isa) {
+        if (isIsaSupported((Isa)isa)) {
+            return (Isa)isa;
+        }
+    }
+
+    return GENERIC;
+}
+
+bool ising::isIsaSupported(Isa isa) {
+    switch (isa) {
+        case SCALAR:
+        case GENERIC:
+            return true;
+#ifdef X86_KERNELS
+        case AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") &&
+                   __builtin_cpu_supports("fma") &&
+                   __builtin_cpu_supports("popcnt");
+        case AVX512:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx512f") &&
+                   __builtin_cpu_supports("avx512bw") &&
+                   __builtin_cpu_supports("avx512vl") &&
+                   __builtin_cpu_supports("avx512vpopcntdq") &&
+                   __builtin_cpu_supports("popcnt");
+#endif
+        default:
+            return false;
+    }
+}
+
+const char* ising::getIsaName(Isa isa) { return kernelTable[isa]->name; }
+
+Isa ising::findIsa(const std::string& name) {
+    for (int isa = 0; isa < NUM_ISAS; ++isa) {
+        if (name == kernelTable[isa]->name) {
+            return (Isa)isa;
+        }
+    }
+
+    std::cout << "INVALID INSTRUCTION SET " << name << "! Exiting...\n\n";
+    exit(EXIT_FAILURE);
+}
+
+void ising::selectKernels(Isa isa) {
+    if (!isIsaSupported(isa)) {
+        std::cout << "INSTRUCTION SET " << getIsaName(isa)
+                  << " NOT SUPPORTED BY THIS CPU! Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    activeKernels = kernelTable[isa];
+}
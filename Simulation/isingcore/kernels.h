@@ -0,0 +1,55 @@
+#ifndef KERNELS_H_
+#define KERNELS_H_
+
+#include <cstdint>
+#include <string>
+#include "common.h"
+
+namespace ising {
+// Instruction set levels the vector kernels are compiled for. SCALAR turns
+// vectorization off, and GENERIC is the baseline the binary is built for.
+enum Isa { SCALAR, GENERIC, AVX2, AVX512, NUM_ISAS };
+
+// The vectorizable hot loops, compiled once per Isa into a table of which
+// one is selected at startup. Lengths count elements.
+struct Kernels {
+    const char* name;
+
+    // a[i] += scale * b[i]: field updates of arena and dense sweeps
+    void (*addScaledChars)(int* a, const char* b, int scale, uint n);
+    void (*addScaledInt8)(int* a, const int8_t* b, int scale, uint n);
+    void (*addScaledInt16)(int* a, const int16_t* b, int scale, uint n);
+    void (*addScaledFloats)(float* a, const float* b, float scale, uint n);
+    // a[i] *= b[i] and a[i] += b[i]: products and sums of k-body terms
+    void (*multiplyChars)(int* a, const char* b, uint n);
+    void (*addInts)(int* a, const int* b, uint n);
+    // e[i] = -s[i] * f[i]: index energies from local fields
+    void (*findEnergies)(int* e, const char* s, const int* f, uint n);
+    // x[i] = scale * log(1 - x[i]): Metropolis thresholds from uniforms
+    void (*findThresholds)(float* x, float scale, uint n);
+
+    // Magnetization reductions, over bytes or packed words
+    int (*sumChars)(const char* s, uint n);
+    uint (*popcount)(const uint64_t* a, uint n);
+    uint (*popcountAnd)(const uint64_t* a, const uint64_t* b, uint n);
+    // Replica overlaps: indices at which two configurations differ
+    uint (*popcountXor)(const uint64_t* a, const uint64_t* b, uint n);
+    uint (*countDifferentChars)(const char* a, const char* b, uint n);
+
+    // Correlation accumulation: sum of x[i] * phases[i]
+    cdouble (*dotPhases)(const double* x, const cdouble* phases, uint n);
+};
+
+extern const Kernels* activeKernels;
+
+inline const Kernels& getKernels() { return *activeKernels; }
+
+Isa detectIsa();
+bool isIsaSupported(Isa isa);
+const char* getIsaName(Isa isa);
+Isa findIsa(const std::string& name);
+// Switches every kernel to the given level, exiting when this CPU lacks it
+void selectKernels(Isa isa);
+}
+
+#endif /* KERNELS_H_ */
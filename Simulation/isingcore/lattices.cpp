@@ -6,14 +6,24 @@ using namespace ising;
 // Lattice //
 /////////////
 
+char Lattice::defaultIndexOrder = NATURAL_ORDER;
+double Lattice::defaultNFoldTemperature = 0;
+uint Lattice::defaultSweepThreads = 1;
+
 Lattice::Lattice(Hamiltonian h, double t, double dt, int n, char m)
     : prop(h, t, dt, n, m) {
+    prop.indexOrder = defaultIndexOrder;
+    prop.nFoldTemperature = defaultNFoldTemperature;
+    prop.sweepThreads = defaultSweepThreads;
+    checkCouplingMode(m);
     mapsToSequences();
     setType("default");
     setSize((int)sqrt(getNumIndices()));
     setJTemperature(t + n / 2 * dt);
     generateDistances();
-    gen = RandomGenerator();
+
+    prop.packedSpins =
+        (uint64_t)prop.numT * REPLICAS * prop.numIndices >= PACKED_SPIN_BYTES;
 
     for (uint i = 0; i < prop.numT; ++i) {
         replicavector replicas;
@@ -25,14 +35,237 @@ Lattice::Lattice(Hamiltonian h, double t, double dt, int n, char m)
     }
 
     std::sort(replicaIndices.begin(), replicaIndices.end());
+
+    qIndices.reserve(prop.numIndices);
+    cluster.reserve(prop.numIndices);
+    unbranched.reserve(prop.numIndices);
+    clusterMarks.assign(prop.numIndices, 0);
+
+    if (prop.mode == VECTORIZED) {
+        initArena();
+    }
+}
+
+// In VECTORIZED mode the arena holds the authoritative spins. Sweeps,
+// swaps and cluster moves all happen there, and a replica is only refreshed
+// from it when it is asked for, so that measuring one temperature costs one
+// copy rather than copying every replica after every step.
+void Lattice::initArena() {
+    arena = std::make_unique<ReplicaArena>(prop, REPLICAS);
+    arena->seed(RandomGenerator::getRunSeed(),
+                RandomGenerator::makeStream(0, 0, ARENA_STREAM));
+
+    // Sweeps happen in the arena, so replicas need no cached energies
+    for (auto& replicas : configs) {
+        for (auto& replica : replicas) {
+            replica->setLocalFields(false);
+            replica->setTermSigns(false);
+        }
+    }
+
+    loadArena();
+}
+
+void Lattice::loadArena() {
+    for (uint i = 0; i < prop.numT; ++i) {
+        for (uint j = 0; j < REPLICAS; ++j) {
+            arena->load(i, j, *configs[i][j]);
+        }
+    }
+
+    staleReplicas.assign(prop.numT * REPLICAS, 0);
+}
+
+void Lattice::syncReplica(uint i, uint j) {
+    char& stale = staleReplicas[i * REPLICAS + j];
+
+    if (stale) {
+        arena->store(i, j, *configs[i][j]);
+        stale = 0;
+    }
+}
+
+void Lattice::syncReplicas() {
+    if (arena) {
+        for (uint i = 0; i < prop.numT; ++i) {
+            for (uint j = 0; j < REPLICAS; ++j) {
+                syncReplica(i, j);
+            }
+        }
+    }
+}
+
+// Gives the lattice and each of its replicas the streams of the given trial
+// under the run seed, so a trial is reproducible regardless of which thread
+// or in which order lattices were built. Spins are redrawn from the new
+// streams.
+void Lattice::seed(uint trial) {
+    uint64_t runSeed = RandomGenerator::getRunSeed();
+    gen.setStream(runSeed,
+                  RandomGenerator::makeStream(trial, 0, LATTICE_STREAM));
+
+    for (uint i = 0; i < prop.numT; ++i) {
+        for (uint j = 0; j < REPLICAS; ++j) {
+            configs[i][j]->seed(runSeed,
+                                RandomGenerator::makeStream(trial, i, j));
+        }
+    }
+
+    if (arena) {
+        arena->seed(runSeed,
+                    RandomGenerator::makeStream(trial, 0, ARENA_STREAM));
+        loadArena();
+    }
+}
+
+void Lattice::setLocalFields(bool enable) {
+    prop.localFields = enable;
+
+    for (auto& replicas : configs) {
+        for (auto& replica : replicas) {
+            replica->setLocalFields(enable);
+        }
+    }
+}
+
+void Lattice::setTermSigns(bool enable) {
+    if (prop.interactions.pairwise || prop.hamiltonian.hasRealCouplings()) {
+        return;
+    }
+
+    prop.termSigns = enable;
+
+    for (auto& replicas : configs) {
+        for (auto& replica : replicas) {
+            replica->setTermSigns(enable);
+        }
+    }
+}
+
+void Lattice::setPackedSpins(bool enable) {
+    prop.packedSpins = enable;
+
+    for (auto& replicas : configs) {
+        for (auto& replica : replicas) {
+            replica->setPackedSpins(enable);
+        }
+    }
+}
+
+// Each index lists its terms in the order of hFunction, so the entries of
+// every copy of the couplings are found by counting terms per index
+void Lattice::setCouplingSigns(const cvector& signs) {
+    if (signs.size() != prop.hFunction.size()) {
+        std::cout << "NUMBER OF COUPLING SIGNS DOES NOT MATCH THE "
+                  << "HAMILTONIAN! Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    if (baseCouplings.empty()) {
+        for (auto& interaction : prop.hFunction) {
+            baseCouplings.push_back(interaction[0]);
+        }
+    }
+
+    CompiledInteractions& compiled = prop.interactions;
+    const dvector& realCouplings = prop.hamiltonian.getCouplings();
+    ivector positions(prop.numIndices, 0);
+
+    for (uint k = 0; k < prop.hFunction.size(); ++k) {
+        ivector& interaction = prop.hFunction[k];
+        int coupling = baseCouplings[k] * signs[k];
+        interaction[0] = coupling;
+
+        for (auto it = interaction.begin() + 1; it != interaction.end();
+             ++it) {
+            int entry = positions[*it]++;
+            uint32_t e = compiled.siteOffsets[*it] + entry;
+
+            prop.indInteractions[*it][entry][0] = coupling;
+            compiled.couplings[e] = coupling;
+            if (!realCouplings.empty()) {
+                compiled.realCouplings[e] = realCouplings[k] * signs[k];
+            }
+            if (!compiled.pairwise) {
+                compiled.termCouplings[compiled.termIds[e]] = coupling;
+            }
+        }
+    }
+
+    if (prop.stencil.kind != NO_STENCIL) {
+        prop.stencil = StencilInteractions();
+        matchStencils();
+    }
+}
+
+// A pairwise term crosses the cut when its indices lie more than half the
+// lattice apart, i.e. it wraps around the boundary
+ivector Lattice::findSeam(int dimension) const {
+    ivector seam;
+
+    if (prop.hamiltonian.getLocations().empty()) {
+        return seam;
+    }
+
+    int extent = dimension == 0 ? prop.hamiltonian.getRows()
+                                : prop.hamiltonian.getCols();
+
+    for (uint k = 0; k < prop.hFunction.size(); ++k) {
+        const ivector& interaction = prop.hFunction[k];
+
+        if (interaction.size() == 3 &&
+            std::abs(prop.locations[interaction[1]][dimension] -
+                     prop.locations[interaction[2]][dimension]) > extent / 2) {
+            seam.push_back(k);
+        }
+    }
+
+    return seam;
 }
 
+// Original labels in the order they are numbered, as chosen by indexOrder
+ivector Lattice::findIndexOrder() const {
+    bool located = !prop.hamiltonian.getLocations().empty();
+
+    switch (prop.indexOrder) {
+        case NATURAL_ORDER:
+            return prop.hamiltonian.getIndices();
+        case LOCALITY_ORDER:
+            if (!located) {
+                return findRCMOrder(prop.hamiltonian.getIndices(),
+                                    prop.hamiltonian.getLocalTerms());
+            }
+        // Fall through
+        case HILBERT_ORDER:
+            if (!located) {
+                std::cout << "NO LOCATIONS TO ORDER INDICES BY! Exiting...\n\n";
+                exit(EXIT_FAILURE);
+            }
+
+            return findHilbertOrder(prop.hamiltonian.getIndices(),
+                                    prop.hamiltonian.getLocations());
+        case RCM_ORDER:
+            return findRCMOrder(prop.hamiltonian.getIndices(),
+                                prop.hamiltonian.getLocalTerms());
+        default:
+            std::cout << "INVALID INDEX ORDER! Exiting...\n\n";
+            exit(EXIT_FAILURE);
+    }
+}
+
+// Every per-index array is built through indMap, so reordering the indices
+// only changes the map. Original labels are kept for output.
 void Lattice::mapsToSequences() {
     // Create map from original indices to new sequential locations
     auto origIndices = prop.hamiltonian.getIndices();
+    prop.originalIndices = findIndexOrder();
     std::map<int, int> indMap;
     for (uint i = 0; i < prop.numIndices; ++i) {
-        indMap[origIndices[i]] = i;
+        indMap[prop.originalIndices[i]] = i;
+    }
+
+    for (auto& i : origIndices) {
+        prop.labelPositions.push_back(indMap[i]);
     }
 
     // Initialize sequential indices
@@ -69,18 +302,265 @@ void Lattice::mapsToSequences() {
     prop.localTerms.resize(prop.numIndices);
     auto origLocalTerms = prop.hamiltonian.getLocalTerms();
     for (auto& terms : origLocalTerms) {
-        prop.localTerms[indMap[terms.first]] = terms.second;
+        ivector& localTerms = prop.localTerms[indMap[terms.first]];
+
+        for (auto& i : terms.second) {
+            localTerms.push_back(indMap[i]);
+        }
     }
 
     // Initialize sequential index interactions
     prop.indInteractions.resize(prop.numIndices);
     auto origIndInteractions = prop.hamiltonian.getIndInteractions();
-    for (auto& interaction : origIndInteractions) {
-        prop.indInteractions[indMap[interaction.first]] = interaction.second;
+    for (auto& interactions : origIndInteractions) {
+        ivector2& indInteractions =
+            prop.indInteractions[indMap[interactions.first]];
+
+        for (auto& interaction : interactions.second) {
+            ivector mapped = {interaction[0]};
+            for (auto it = interaction.begin() + 1; it != interaction.end();
+                 ++it) {
+                mapped.push_back(indMap[*it]);
+            }
+
+            indInteractions.push_back(mapped);
+        }
     }
+
+    compileInteractions();
+    colorInteractions();
+    matchStencils();
+}
+
+void Lattice::compileInteractions() {
+    CompiledInteractions& compiled = prop.interactions;
+
+    compiled.siteOffsets.push_back(0);
+    compiled.termOffsets.push_back(0);
+    for (auto& interactions : prop.indInteractions) {
+        int weight = 0;
+
+        for (auto& interaction : interactions) {
+            // Symmetric bounds, so that flipping the sign of a coupling
+            // keeps it in range
+            if (abs(interaction[0]) > INT16_MAX) {
+                std::cout << "COUPLING OUTSIDE THE INT16 RANGE! "
+                          << "Exiting...\n\n";
+                exit(EXIT_FAILURE);
+            }
+
+            compiled.couplings.push_back(interaction[0]);
+            weight += abs(interaction[0]);
+
+            if (interaction.size() != 2) {
+                compiled.pairwise = false;
+            }
+
+            for (auto it = interaction.begin() + 1; it != interaction.end();
+                 ++it) {
+                compiled.neighbors.push_back(*it);
+            }
+
+            compiled.termOffsets.push_back(compiled.neighbors.size());
+        }
+
+        compiled.siteOffsets.push_back(compiled.couplings.size());
+
+        // Cache local fields by default when indices have many terms
+        if (interactions.size() >= LOCAL_FIELD_TERMS) {
+            prop.localFields = true;
+        }
+
+        // Bound the magnitude of any single index energy for acceptance tables
+        prop.maxIndexEnergy = std::max(prop.maxIndexEnergy, weight);
+    }
+
+    // Cached term signs make k-body flips cost one update per term, which
+    // beats caching fields there
+    if (!compiled.pairwise) {
+        numberTerms();
+        prop.termSigns = true;
+        prop.localFields = false;
+    }
+
+    if (prop.hamiltonian.hasRealCouplings()) {
+        compileRealCouplings();
+    }
+}
+
+// Each index lists its terms in the order of hFunction, so entries are
+// matched to the real coupling of their term by counting terms per index,
+// as setCouplingSigns does. Term signs only hold integer couplings, so real
+// ones always cache float local fields instead.
+void Lattice::compileRealCouplings() {
+    CompiledInteractions& compiled = prop.interactions;
+    const dvector& realCouplings = prop.hamiltonian.getCouplings();
+    ivector positions(prop.numIndices, 0);
+
+    compiled.realCouplings.resize(compiled.couplings.size());
+    for (uint k = 0; k < prop.hFunction.size(); ++k) {
+        const ivector& interaction = prop.hFunction[k];
+
+        for (auto it = interaction.begin() + 1; it != interaction.end();
+             ++it) {
+            uint32_t e = compiled.siteOffsets[*it] + positions[*it]++;
+            compiled.realCouplings[e] = realCouplings[k];
+        }
+    }
+
+    prop.termSigns = false;
+    prop.localFields = true;
+}
+
+// Real couplings sweep one replica at a time by Metropolis. The arena,
+// multi-spin and cluster engines, demons and the n-fold way all count
+// integer energies.
+void Lattice::checkCouplingMode(char m) const {
+    if (prop.hamiltonian.hasRealCouplings() && m != ALL && m != PSEUDO &&
+        m != RANDOM && m != COLORED) {
+        std::cout << "REAL COUPLINGS ONLY RUN IN ALL, PSEUDO, RANDOM OR "
+                     "COLORED MODE! Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+}
+
+// A term is listed once for each of its indices. Entries with the same set
+// of indices are matched up by the order they appear in at each index, so
+// repeated terms stay distinct.
+void Lattice::numberTerms() {
+    CompiledInteractions& compiled = prop.interactions;
+    std::map<ivector, std::vector<uint32_t>> ids;
+
+    for (uint i = 0; i < prop.numIndices; ++i) {
+        std::map<ivector, uint> occurrences;
+
+        for (uint32_t k = compiled.siteOffsets[i];
+             k < compiled.siteOffsets[i + 1]; ++k) {
+            ivector members = {(int)i};
+            for (uint32_t n = compiled.termOffsets[k];
+                 n < compiled.termOffsets[k + 1]; ++n) {
+                members.push_back(compiled.neighbors[n]);
+            }
+            std::sort(members.begin(), members.end());
+
+            auto& memberIds = ids[members];
+            uint occurrence = occurrences[members]++;
+            if (occurrence == memberIds.size()) {
+                memberIds.push_back(compiled.termCouplings.size());
+                compiled.termCouplings.push_back(compiled.couplings[k]);
+            }
+
+            compiled.termIds.push_back(memberIds[occurrence]);
+        }
+    }
+}
+
+// Greedy coloring of the interaction graph: indices sharing a term never
+// share a color, so each color class can be updated in bulk. This reduces
+// to a checkerboard on even square lattices.
+void Lattice::colorInteractions() {
+    ivector colors(prop.numIndices, -1);
+    std::vector<bool> used;
+
+    for (uint i = 0; i < prop.numIndices; ++i) {
+        used.assign(used.size(), false);
+
+        for (auto& j : prop.localTerms[i]) {
+            if (colors[j] != -1) {
+                used[colors[j]] = true;
+            }
+        }
+
+        int color = 0;
+        while (color < (int)used.size() && used[color]) {
+            ++color;
+        }
+
+        if (color == (int)used.size()) {
+            used.push_back(false);
+            prop.colorClasses.emplace_back();
+        }
+
+        colors[i] = color;
+        prop.colorClasses[color].push_back(i);
+    }
+}
+
+// Periodic lattices from generate_hamiltonian.py are swept with kernels
+// specialized on their stencil. Any other Hamiltonian (toric layouts,
+// k-body terms, missing dimensions, couplings beyond int8_t) keeps
+// prop.stencil.kind == NO_STENCIL and uses the compiled interactions.
+void Lattice::matchStencils() {
+    matchStencil<SQUARE_NN>() || matchStencil<TRIANGLE_NN>() ||
+        matchStencil<SQUARE_NNN>() || matchStencil<TRIANGLE_NNN>();
+}
+
+template <int S>
+bool Lattice::matchStencil() {
+    typedef Stencil<S> St;
+    const int bonds = 2 * St::FORWARD;
+    int rows = prop.hamiltonian.getRows();
+    int cols = prop.hamiltonian.getCols();
+    int numIndices = prop.numIndices;
+
+    // Stencils address neighbors by row-major position
+    if (!prop.interactions.pairwise || prop.hamiltonian.hasRealCouplings() ||
+        rows * cols != numIndices ||
+        rows <= 2 * St::REACH || cols <= 2 * St::REACH ||
+        prop.hamiltonian.getIndices().back() != numIndices - 1 ||
+        prop.indexOrder != NATURAL_ORDER) {
+        return false;
+    }
+
+    auto shift = [rows, cols](int i, const StencilOffset& o) {
+        return ((i / cols + o.dr + rows) % rows) * cols +
+               (i % cols + o.dc + cols) % cols;
+    };
+
+    ivector couplings(numIndices * bonds, 0);
+    for (auto& interaction : prop.hFunction) {
+        int a = interaction[1];
+        int b = interaction[2];
+        bool matched = false;
+
+        for (int k = 0; k < St::FORWARD && !matched; ++k) {
+            if (shift(b, St::offsets[k]) == a) {
+                std::swap(a, b);
+            }
+
+            if (shift(a, St::offsets[k]) == b) {
+                couplings[a * bonds + k] += interaction[0];
+                couplings[b * bonds + St::FORWARD + k] += interaction[0];
+                matched = true;
+            }
+        }
+
+        if (!matched) {
+            return false;
+        }
+    }
+
+    for (auto& c : couplings) {
+        if (c < INT8_MIN || c > INT8_MAX) {
+            return false;
+        }
+    }
+
+    prop.stencil.kind = S;
+    prop.stencil.reach = St::REACH;
+    prop.stencil.couplings.assign(couplings.begin(), couplings.end());
+    for (int c = -St::REACH; c < cols + St::REACH; ++c) {
+        prop.stencil.columns.push_back((c + cols) % cols);
+    }
+
+    return true;
 }
 
 void Lattice::generateDistances() {
+    if (prop.numIndices > DISTANCE_TABLE_INDICES) {
+        return;
+    }
+
     prop.xDisplacements.resize(prop.numIndices);
     prop.yDisplacements.resize(prop.numIndices);
     prop.distances.resize(prop.numIndices);
@@ -100,16 +580,35 @@ void Lattice::generateDistances() {
     }
 }
 
-Replica Lattice::getReplicaCopy(uint i, uint j) {
-    if (i >= configs.size() && j > REPLICAS) {
+const replicavector2& Lattice::getConfigs() {
+    syncReplicas();
+    return configs;
+}
+
+const Replica& Lattice::getReplica(uint i, uint j) {
+    if (i >= configs.size() || j >= REPLICAS) {
         std::cout << "INVALID CONFIGURATION/REPLICA INDICES! Exiting...\n\n";
         exit(EXIT_FAILURE);
     }
 
-    return *configs[i][j].get();
+    if (arena) {
+        syncReplica(i, j);
+    }
+
+    return *configs[i][j];
+}
+
+Replica Lattice::getReplicaCopy(uint i, uint j) {
+    return getReplica(i, j);
 }
 
 void Lattice::monteCarloSweep() {
+    if (arena) {
+        arena->monteCarloSweep();
+        std::fill(staleReplicas.begin(), staleReplicas.end(), 1);
+        return;
+    }
+
     for (auto& replicas : configs) {
         for (auto& replica : replicas) {
             replica->update();
@@ -117,89 +616,150 @@ void Lattice::monteCarloSweep() {
     }
 }
 
+namespace {
+// The two replicas at one temperature slot as Houdayer moves see them,
+// whether they live in Replica objects or in the arena
+struct ReplicaPair {
+    Replica& replica0;
+    Replica& replica1;
+
+    int getSpin(uint r, uint i) const {
+        return (r ? replica1 : replica0).getSpin(i);
+    }
+    uint countDifferences() const {
+        return replica0.countDifferences(replica1);
+    }
+    void flipSpins(uint r) { (r ? replica1 : replica0).flipSpins(); }
+    void flipSpin(uint r, uint i) { (r ? replica1 : replica0).flipSpin(i); }
+};
+
+struct ArenaPair {
+    ReplicaArena& arena;
+    uint t;
+
+    int getSpin(uint r, uint i) const { return arena.getSpin(t, r, i); }
+    uint countDifferences() const { return arena.countDifferences(t, 0, 1); }
+    void flipSpins(uint r) { arena.flipSpins(t, r); }
+    void flipSpin(uint r, uint i) { arena.flipSpin(t, r, i); }
+};
+}
+
 void Lattice::houdayerClusterMove() {
     for (uint i = 0; i < configs.size(); ++i) {
         houdayerClusterMove(i);
     }
 }
 
+// Indices on which the two replicas of the pair disagree
+template <class P>
+void Lattice::findDisagreements(P pair) {
+    qIndices.clear();
+    for (uint i = 0; i < prop.numIndices; ++i) {
+        if (pair.getSpin(0, i) != pair.getSpin(1, i)) {
+            qIndices.push_back(i);
+        }
+    }
+}
+
+// Flips a connected cluster of disagreeing indices in both replicas, which
+// keeps their summed energy only when every term is pairwise; other
+// Hamiltonians skip the move.
 void Lattice::houdayerClusterMove(uint index) {
-    auto spins0 = configs[index][0]->getSpins();
-    auto spins1 = configs[index][1]->getSpins();
-
-    bool done = false;
-    while (!done) {
-        ivector qIndices;
-        for (uint i = 0; i < prop.numIndices; ++i) {
-            spins0[i] *= spins1[i];
-            if (spins0[i] == 0) {
-                qIndices.push_back(i);
-            }
+    if (!prop.interactions.pairwise) {
+        return;
+    }
+
+    if (arena) {
+        flipHoudayerCluster(ArenaPair{*arena, index});
+        staleReplicas[index * REPLICAS] = 1;
+        staleReplicas[index * REPLICAS + 1] = 1;
+    } else {
+        flipHoudayerCluster(
+            ReplicaPair{*configs[index][0], *configs[index][1]});
+    }
+}
+
+// Cluster membership is marked per index rather than searched for, so
+// growth is linear in the cluster size.
+template <class P>
+void Lattice::flipHoudayerCluster(P pair) {
+    // Relabel replica 0 so that at most half of the indices disagree
+    if (2 * pair.countDifferences() > prop.numIndices) {
+        pair.flipSpins(0);
+    }
+    findDisagreements(pair);
+
+    if (!qIndices.empty()) {
+        for (auto& i : qIndices) {
+            clusterMarks[i] = 1;
         }
 
-        if (qIndices.size() == 0) {
-            done = true;
-        } else if (2 * qIndices.size() > prop.numIndices) {
-            configs[index][0]->flipSpins();
-        } else {
-            ivector cluster = {qIndices[gen.MWC() % qIndices.size()]};
-            ivector unbranched = cluster;
-
-            while (!unbranched.empty()) {
-                int ind = unbranched.back();
-                unbranched.pop_back();
-
-                for (auto& i : prop.localTerms[ind]) {
-                    if (std::find(cluster.begin(), cluster.end(), i) ==
-                            cluster.end() &&
-                        std::binary_search(qIndices.begin(), qIndices.end(),
-                                           i)) {
-                        cluster.push_back(i);
-                        unbranched.push_back(i);
-                    }
+        int start = qIndices[gen.randInt() % qIndices.size()];
+        clusterMarks[start] = 2;
+        cluster.assign(1, start);
+        unbranched.assign(1, start);
+
+        while (!unbranched.empty()) {
+            int ind = unbranched.back();
+            unbranched.pop_back();
+
+            for (auto& i : prop.localTerms[ind]) {
+                if (clusterMarks[i] == 1) {
+                    clusterMarks[i] = 2;
+                    cluster.push_back(i);
+                    unbranched.push_back(i);
                 }
             }
+        }
 
-            for (auto& i : cluster) {
-                configs[index][0]->flipSpin(i);
-                configs[index][1]->flipSpin(i);
-            }
+        for (auto& i : cluster) {
+            pair.flipSpin(0, i);
+            pair.flipSpin(1, i);
+        }
 
-            done = true;
+        for (auto& i : qIndices) {
+            clusterMarks[i] = 0;
         }
     }
 }
 
+// Each replica column exchanges configurations between neighboring
+// temperatures on its own, using the running energies of the replicas.
 void Lattice::parallelTemperingUpdate() {
-    for (uint i = 0; i < prop.numT - 1; ++i) {
-        double dEnergy = configs[i][0]->getTotalEnergy() -
-                         configs[i + 1][0]->getTotalEnergy();
-        double dBoltzmann = 1 / (KB * configs[i][0]->getTemperature()) -
-                            1 / (KB * configs[i + 1][0]->getTemperature());
-        double probability = dEnergy * dBoltzmann;
+    if (arena) {
+        arena->parallelTemperingUpdate();
+        std::fill(staleReplicas.begin(), staleReplicas.end(), 1);
+        return;
+    }
 
-        if (probability > 1 || probability > gen.randFloatCO()) {
-            for (uint j = 0; j < REPLICAS; ++j) {
-                swapConfigs(i, i + 1);
+    for (uint i = 0; i < prop.numT - 1; ++i) {
+        for (uint j = 0; j < REPLICAS; ++j) {
+            double dEnergy = configs[i][j]->getEnergy() -
+                             configs[i + 1][j]->getEnergy();
+            double dBoltzmann = 1 / configs[i][j]->getTemperature() -
+                                1 / configs[i + 1][j]->getTemperature();
+            double exponent = dEnergy * dBoltzmann;
+
+            if (exponent >= 0 || pow(E, exponent) > gen.randFloatCO()) {
+                swapConfigs(i, i + 1, j);
             }
         }
     }
 }
 
-void Lattice::swapConfigs(uint i, uint j) {
-    if (i == j || i >= configs.size() || j >= configs.size()) {
+void Lattice::swapConfigs(uint i, uint j, uint k) {
+    if (i == j || i >= configs.size() || j >= configs.size() ||
+        k >= REPLICAS) {
         std::cout << "INVALID CONFIGURATION INDEX! Exiting...\n\n";
         exit(EXIT_FAILURE);
     }
 
-    auto t1 = configs[i][0]->getTemperature();
-    auto t2 = configs[j][0]->getTemperature();
+    auto t1 = configs[i][k]->getTemperature();
+    auto t2 = configs[j][k]->getTemperature();
 
-    for (uint k = 0; k < REPLICAS; ++k) {
-        configs[i][k]->setTemperature(t2);
-        configs[j][k]->setTemperature(t1);
-        configs[i][k].swap(configs[j][k]);
-    }
+    configs[i][k]->setTemperature(t2);
+    configs[j][k]->setTemperature(t1);
+    configs[i][k].swap(configs[j][k]);
 }
 
 void Lattice::HCA() {
@@ -222,6 +782,8 @@ void Lattice::ICA() {
 }
 
 void Lattice::switchMode(char m) {
+    checkCouplingMode(m);
+
     switch (m) {
         case ALL:
             setMode(ALL);
@@ -232,10 +794,34 @@ void Lattice::switchMode(char m) {
         case RANDOM:
             setMode(RANDOM);
             break;
+        case COLORED:
+            setMode(COLORED);
+            break;
+        case VECTORIZED:
+            setMode(VECTORIZED);
+            break;
+        case WOLFF:
+            setMode(WOLFF);
+            break;
+        case SWENDSEN_WANG:
+            setMode(SWENDSEN_WANG);
+            break;
+        case DEMON:
+            setMode(DEMON);
+            break;
         default:
             std::cout << "INVALID MODE. Exiting...\n\n";
             exit(EXIT_FAILURE);
     }
+
+    if (m == VECTORIZED && !arena) {
+        initArena();
+    } else if (m != VECTORIZED && arena) {
+        syncReplicas();
+        arena.reset();
+        setLocalFields(prop.localFields);
+        setTermSigns(prop.termSigns);
+    }
 }
 
 void Lattice::shapeError() const {
@@ -298,8 +884,8 @@ int RectangularLattice::findYDisplacement(int i, int j) {
 }
 
 double RectangularLattice::findDistance(int i, int j) {
-    return sqrt(pow(prop.xDisplacements[i][j], 2) +
-                pow(prop.yDisplacements[i][j], 2));
+    return sqrt(pow(findXDisplacement(i, j), 2) +
+                pow(findYDisplacement(i, j), 2));
 }
 
 void RectangularLattice::guessRowsCols() {
@@ -411,8 +997,8 @@ int TriangularLattice::findYDisplacement(int i, int j) {
 }
 
 double TriangularLattice::findDistance(int i, int j) {
-    return sqrt(pow(prop.xDisplacements[i][j], 2) +
-                pow(prop.yDisplacements[i][j], 2));
+    return sqrt(pow(findXDisplacement(i, j), 2) +
+                pow(findYDisplacement(i, j), 2));
 }
 
 void TriangularLattice::guessRowsCols() {
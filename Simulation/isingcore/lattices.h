@@ -4,13 +4,20 @@
 #include <stdlib.h>
 #include <memory>
 #include "hamiltonian.h"
-#include "replica.h"
+#include "replicaarena.h"
 
 typedef std::vector<std::shared_ptr<ising::Replica>> replicavector;
 typedef std::vector<replicavector> replicavector2;
 
 namespace ising {
 const uint REPLICAS = 2;
+const uint LOCAL_FIELD_TERMS = 8;
+// Packed spins sweep no faster than bytes, so they are only the default once
+// byte spins of all replicas would take this much memory
+const uint64_t PACKED_SPIN_BYTES = 1ULL << 28;
+// Displacement and distance tables are N^2, so larger lattices find them
+// on demand instead
+const uint DISTANCE_TABLE_INDICES = 1 << 12;
 
 class Lattice {
    public:
@@ -23,24 +30,38 @@ class Lattice {
     double getChangeTemperature() const { return prop.dT; }
     double getNumTemperatures() const { return prop.numT; }
     char getMode() const { return prop.mode; }
+    bool hasLocalFields() const { return prop.localFields; }
+    bool hasPackedSpins() const { return prop.packedSpins; }
+    bool hasTermSigns() const { return prop.termSigns; }
     int getSize() const { return prop.size; }
     int getRows() const { return prop.rows; }
     int getCols() const { return prop.cols; }
     double getJTemperature() const { return jTemperature; }
+    double getNFoldTemperature() const { return prop.nFoldTemperature; }
 
     const Hamiltonian& getHamiltonian() const { return prop.hamiltonian; }
     const ivector2& getHFunction() const { return prop.hFunction; }
     const ivector& getIndices() const { return prop.indices; }
     int getNumIndices() const { return prop.numIndices; }
+    char getIndexOrder() const { return prop.indexOrder; }
+    const ivector& getOriginalIndices() const { return prop.originalIndices; }
     const i2arrayvector& getLocations() const { return prop.locations; }
     const ivector3& getIndInteractions() const { return prop.indInteractions; }
+    const CompiledInteractions& getInteractions() const {
+        return prop.interactions;
+    }
+    const ivector2& getColorClasses() const { return prop.colorClasses; }
+    int getStencil() const { return prop.stencil.kind; }
     const ivector2& getXDisplacements() const { return prop.xDisplacements; }
     const ivector2& getYDisplacements() const { return prop.yDisplacements; }
     const dvector2& getDistances() const { return prop.distances; }
 
     const LatticeProperties& getProperties() const { return prop; }
-    const replicavector2& getConfigs() const { return configs; }
-    const ivector getReplicaIndices() const { return replicaIndices; }
+    const replicavector2& getConfigs();
+    const ivector& getReplicaIndices() const { return replicaIndices; }
+    // Replica j at temperature slot i, brought up to date with the arena
+    // first in VECTORIZED mode
+    const Replica& getReplica(uint i, uint j = 0);
     Replica getReplicaCopy(unsigned i, unsigned j = 0);
 
     void monteCarloSweep();
@@ -54,6 +75,34 @@ class Lattice {
     virtual int findYDisplacement(int, int) { return 0; };
     virtual double findDistance(int, int) { return 0; }
     void switchMode(char m);
+    void seed(uint trial);
+    void setLocalFields(bool enable);
+    void setTermSigns(bool enable);
+    void setPackedSpins(bool enable);
+    void setSweepThreads(uint n) { prop.sweepThreads = std::max(n, 1U); }
+    // Multiplies the coupling of each term of the Hamiltonian as loaded by
+    // the matching sign, keeping the topology. Replicas keep stale energies
+    // until they are reseeded.
+    void setCouplingSigns(const cvector& signs);
+    // Terms crossing the cut between the last and first row (dimension 0)
+    // or column (dimension 1) of a periodic lattice. Empty when the
+    // Hamiltonian has no locations.
+    ivector findSeam(int dimension) const;
+    // Order of indices in lattices constructed from now on
+    static void setDefaultIndexOrder(char order) { defaultIndexOrder = order; }
+    // Temperature below which replicas of lattices constructed from now on
+    // update by the n-fold way
+    static void setDefaultNFoldTemperature(double t) {
+        defaultNFoldTemperature = t;
+    }
+    static double getDefaultNFoldTemperature() {
+        return defaultNFoldTemperature;
+    }
+    void setNFoldTemperature(double t) { prop.nFoldTemperature = t; }
+    // Threads sharing the sweeps of lattices constructed from now on
+    static void setDefaultSweepThreads(uint n) {
+        defaultSweepThreads = std::max(n, 1U);
+    }
     void setTemperature(double t);
     void setJTemperature(double t) { jTemperature = t; }
 
@@ -74,10 +123,43 @@ class Lattice {
    private:
     replicavector2 configs;
     ivector replicaIndices;
+    ivector baseCouplings;
+    std::unique_ptr<ReplicaArena> arena;
+    // Replicas whose configuration in the arena has changed since it was
+    // last copied to them, flagged per temperature slot and replica
+    cvector staleReplicas;
     double jTemperature;
 
+    // Scratch of houdayerClusterMove, sized once so that moves in the
+    // steady state do not allocate
+    ivector qIndices;
+    ivector cluster;
+    ivector unbranched;
+    cvector clusterMarks;
+
+    static char defaultIndexOrder;
+    static double defaultNFoldTemperature;
+    static uint defaultSweepThreads;
+
     void mapsToSequences();
-    void swapConfigs(uint i, uint j);
+    ivector findIndexOrder() const;
+    void initArena();
+    void loadArena();
+    void syncReplica(uint i, uint j);
+    void syncReplicas();
+    void compileInteractions();
+    void compileRealCouplings();
+    void checkCouplingMode(char m) const;
+    void numberTerms();
+    void colorInteractions();
+    void matchStencils();
+    template <int S>
+    bool matchStencil();
+    void swapConfigs(uint i, uint j, uint k);
+    template <class P>
+    void flipHoudayerCluster(P pair);
+    template <class P>
+    void findDisagreements(P pair);
 };
 
 class RectangularLattice : public virtual Lattice {
@@ -0,0 +1,355 @@
+#include "multispinlattice.h"
+
+using namespace ising;
+
+namespace {
+inline void addWeighted(uint64_t* sum, uint planes, uint64_t bits,
+                        int weight) {
+    for (uint b = 0; weight != 0; ++b, weight >>= 1) {
+        if ((weight & 1) == 0) {
+            continue;
+        }
+
+        uint64_t carry = bits;
+        for (uint p = b; carry != 0 && p < planes; ++p) {
+            uint64_t next = sum[p] & carry;
+            sum[p] ^= carry;
+            carry = next;
+        }
+    }
+}
+
+inline uint64_t broadcast(uint64_t value, uint bit) {
+    return ((value >> bit) & 1) ? ~0ULL : 0ULL;
+}
+
+inline uint64_t findGreaterEqual(const uint64_t* sum, uint planes, int k) {
+    uint64_t greater = 0;
+    uint64_t equal = ~0ULL;
+
+    for (int p = (int)planes - 1; p >= 0; --p) {
+        uint64_t kBits = broadcast(k, p);
+        greater |= equal & sum[p] & ~kBits;
+        equal &= ~(sum[p] ^ kBits);
+    }
+
+    return greater | equal;
+}
+
+inline uint64_t findEqual(const uint64_t* sum, uint planes, int k) {
+    uint64_t equal = ~0ULL;
+
+    for (uint p = 0; p < planes; ++p) {
+        equal &= ~(sum[p] ^ broadcast(k, p));
+    }
+
+    return equal;
+}
+
+inline ivector extractLanes(const uint64_t* sum, uint planes, uint lanes) {
+    ivector counts(lanes, 0);
+
+    for (uint l = 0; l < lanes; ++l) {
+        for (uint p = 0; p < planes; ++p) {
+            counts[l] += (int)(((sum[p] >> l) & 1) << p);
+        }
+    }
+
+    return counts;
+}
+}
+
+MultiSpinLattice::MultiSpinLattice(Lattice* latt, uint n)
+    : lattice(latt), prop(latt->getProperties()), lanes(n) {
+    if (lanes == 0 || lanes > LANES) {
+        std::cout << "INVALID NUMBER OF LANES! Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    laneMask = (lanes == LANES) ? ~0ULL : ((1ULL << lanes) - 1);
+
+    for (uint t = 0; t < prop.numT; ++t) {
+        temperatures.push_back(prop.minT + t * prop.dT);
+    }
+
+    generateTerms();
+    generateProbabilities();
+
+    spins.resize(prop.numT, wvector(prop.numIndices));
+    reinit();
+}
+
+void MultiSpinLattice::generateTerms() {
+    int maxWeight = 0;
+
+    siteTerms.push_back(0);
+    termIndices.push_back(0);
+    for (uint i = 0; i < prop.numIndices; ++i) {
+        int weight = 0;
+
+        for (auto& interaction : prop.indInteractions[i]) {
+            if (interaction[0] == 0) {
+                continue;
+            }
+
+            termWeights.push_back(abs(interaction[0]));
+            termSigns.push_back(interaction[0] < 0 ? ~0ULL : 0ULL);
+            weight += abs(interaction[0]);
+
+            for (auto it = interaction.begin() + 1; it != interaction.end();
+                 ++it) {
+                termNeighbors.push_back(*it);
+            }
+
+            termIndices.push_back((int)termNeighbors.size());
+        }
+
+        siteWeights.push_back(weight);
+        siteTerms.push_back((int)termWeights.size());
+        maxWeight = std::max(maxWeight, weight);
+    }
+
+    totalWeight = 0;
+    energyIndices.push_back(0);
+    for (auto& interaction : prop.hFunction) {
+        if (interaction[0] == 0) {
+            continue;
+        }
+
+        energyWeights.push_back(abs(interaction[0]));
+        energySigns.push_back(interaction[0] < 0 ? ~0ULL : 0ULL);
+        totalWeight += abs(interaction[0]);
+
+        for (auto it = interaction.begin() + 1; it != interaction.end(); ++it) {
+            energyNeighbors.push_back(*it);
+        }
+
+        energyIndices.push_back((int)energyNeighbors.size());
+    }
+
+    sumPlanes = 1;
+    while ((1 << sumPlanes) <= maxWeight) {
+        ++sumPlanes;
+    }
+
+    if (sumPlanes > ENERGY_PLANES) {
+        std::cout << "SITE COUPLING WEIGHT TOO LARGE! Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    levelMasks.resize(maxWeight / 2 + 1);
+    levelProbabilities.resize(maxWeight / 2 + 1);
+}
+
+void MultiSpinLattice::generateProbabilities() {
+    int maxWeight = 0;
+    for (auto& w : siteWeights) {
+        maxWeight = std::max(maxWeight, w);
+    }
+
+    probabilities.resize(prop.numT);
+    for (uint t = 0; t < prop.numT; ++t) {
+        probabilities[t].resize(maxWeight + 1);
+
+        for (int d = 0; d <= maxWeight; ++d) {
+            double p = exp(-2 * d / temperatures[t]) * 4294967296.0;
+            probabilities[t][d] =
+                (p >= 4294967295.0) ? 0xFFFFFFFFU : (uint32_t)p;
+        }
+    }
+}
+
+void MultiSpinLattice::reinit() {
+    for (auto& words : spins) {
+        for (auto& w : words) {
+            w = randomWord() & laneMask;
+        }
+    }
+}
+
+void MultiSpinLattice::seed(uint trial) {
+    gen.setStream(RandomGenerator::getRunSeed(),
+                  RandomGenerator::makeStream(trial, 0, LATTICE_STREAM));
+    reinit();
+}
+
+uint64_t MultiSpinLattice::randomWord() {
+    return gen.randLong();
+}
+
+cvector MultiSpinLattice::getSpins(uint t, uint lane) const {
+    cvector laneSpins(prop.numIndices);
+
+    for (uint i = 0; i < prop.numIndices; ++i) {
+        laneSpins[i] = ((spins[t][i] >> lane) & 1) ? -1 : 1;
+    }
+
+    return laneSpins;
+}
+
+void MultiSpinLattice::monteCarloSweep() {
+    for (uint t = 0; t < prop.numT; ++t) {
+        monteCarloSweep(t);
+    }
+}
+
+void MultiSpinLattice::monteCarloSweep(uint t) {
+    uint64_t* s = spins[t].data();
+    uint64_t sum[ENERGY_PLANES];
+
+    for (uint i = 0; i < prop.numIndices; ++i) {
+        std::fill(sum, sum + sumPlanes, 0);
+
+        for (int k = siteTerms[i]; k < siteTerms[i + 1]; ++k) {
+            uint64_t unsatisfied = s[i] ^ termSigns[k];
+
+            for (int n = termIndices[k]; n < termIndices[k + 1]; ++n) {
+                unsatisfied ^= s[termNeighbors[n]];
+            }
+
+            addWeighted(sum, sumPlanes, unsatisfied, termWeights[k]);
+        }
+
+        s[i] ^= findAcceptance(t, siteWeights[i], sum, sumPlanes) &
+                laneMask;
+    }
+}
+
+// A flip of site i in a lane whose unsatisfied weight is W changes the energy
+// by 2 * (S - 2W), where S is the total coupling weight of the site. Lanes
+// with W >= S / 2 always flip; the remaining lanes compare a lane-private
+// fixed-point uniform against the Boltzmann factor one bit plane at a time,
+// stopping as soon as every lane is decided.
+uint64_t MultiSpinLattice::findAcceptance(uint t, int weight,
+                                          const uint64_t* sum, uint planes) {
+    int kAlways = (weight + 1) / 2;
+    uint64_t always = findGreaterEqual(sum, planes, kAlways);
+    uint64_t undecided = laneMask & ~always;
+
+    if (undecided == 0) {
+        return always;
+    }
+
+    const auto& probs = probabilities[t];
+    uint levels = 0;
+    for (int w = kAlways - 1; w >= 0; --w) {
+        uint32_t p = probs[weight - 2 * w];
+        if (p == 0) {
+            break;
+        }
+
+        uint64_t mask = findEqual(sum, planes, w) & undecided;
+        if (mask != 0) {
+            levelMasks[levels] = mask;
+            levelProbabilities[levels] = p;
+            ++levels;
+        }
+    }
+
+    uint64_t candidates = 0;
+    for (uint l = 0; l < levels; ++l) {
+        candidates |= levelMasks[l];
+    }
+
+    uint64_t accepted = 0;
+    undecided = candidates;
+    for (int bit = PROBABILITY_BITS - 1; bit >= 0 && undecided != 0; --bit) {
+        uint64_t randomBits = randomWord();
+        uint64_t thresholdBits = 0;
+
+        for (uint l = 0; l < levels; ++l) {
+            thresholdBits |=
+                levelMasks[l] & broadcast(levelProbabilities[l], bit);
+        }
+
+        accepted |= undecided & ~randomBits & thresholdBits;
+        undecided &= ~(randomBits ^ thresholdBits);
+    }
+
+    return always | accepted;
+}
+
+void MultiSpinLattice::parallelTemperingUpdate() {
+    if (prop.numT < 2) {
+        return;
+    }
+
+    ivector energies1 = getTotalEnergies(0);
+    for (uint t = 0; t < prop.numT - 1; ++t) {
+        ivector energies2 = getTotalEnergies(t + 1);
+        double dBoltzmann = 1 / temperatures[t] - 1 / temperatures[t + 1];
+        uint64_t mask = 0;
+
+        for (uint l = 0; l < lanes; ++l) {
+            double exponent = dBoltzmann * (energies1[l] - energies2[l]);
+
+            if (exponent >= 0 || exp(exponent) > gen.randFloatCO()) {
+                mask |= 1ULL << l;
+                std::swap(energies1[l], energies2[l]);
+            }
+        }
+
+        swapLanes(t, t + 1, mask);
+        energies1 = energies2;
+    }
+}
+
+void MultiSpinLattice::swapLanes(uint t1, uint t2, uint64_t mask) {
+    if (mask == 0) {
+        return;
+    }
+
+    uint64_t* s1 = spins[t1].data();
+    uint64_t* s2 = spins[t2].data();
+
+    for (uint i = 0; i < prop.numIndices; ++i) {
+        uint64_t diff = (s1[i] ^ s2[i]) & mask;
+        s1[i] ^= diff;
+        s2[i] ^= diff;
+    }
+}
+
+void MultiSpinLattice::update() {
+    monteCarloSweep();
+    parallelTemperingUpdate();
+}
+
+ivector MultiSpinLattice::getTotalEnergies(uint t) const {
+    const uint64_t* s = spins[t].data();
+    uint64_t sum[ENERGY_PLANES] = {0};
+
+    for (uint k = 0; k < energyWeights.size(); ++k) {
+        uint64_t unsatisfied = energySigns[k];
+
+        for (int n = energyIndices[k]; n < energyIndices[k + 1]; ++n) {
+            unsatisfied ^= s[energyNeighbors[n]];
+        }
+
+        addWeighted(sum, ENERGY_PLANES, unsatisfied, energyWeights[k]);
+    }
+
+    ivector energies = extractLanes(sum, ENERGY_PLANES, lanes);
+    for (auto& e : energies) {
+        e = 2 * e - totalWeight;
+    }
+
+    return energies;
+}
+
+dvector MultiSpinLattice::getMagnetizations(uint t) const {
+    const uint64_t* s = spins[t].data();
+    uint64_t sum[ENERGY_PLANES] = {0};
+
+    for (uint i = 0; i < prop.numIndices; ++i) {
+        addWeighted(sum, ENERGY_PLANES, s[i], 1);
+    }
+
+    ivector down = extractLanes(sum, ENERGY_PLANES, lanes);
+    dvector magnetizations;
+    for (auto& d : down) {
+        magnetizations.push_back((double)((int)prop.numIndices - 2 * d) /
+                                 prop.numIndices);
+    }
+
+    return magnetizations;
+}
@@ -0,0 +1,79 @@
+#ifndef MULTISPINLATTICE_H_
+#define MULTISPINLATTICE_H_
+
+#include <cstdint>
+#include "lattices.h"
+
+namespace ising {
+const uint LANES = 64;
+const uint PROBABILITY_BITS = 32;
+const uint ENERGY_PLANES = 32;
+
+// Multi-spin coded Metropolis engine: bit l of spins[t][i] holds spin i of
+// trial l at temperature slot t (set bit = spin down). All lanes share the
+// topology of the wrapped lattice; each lane draws its own uniforms so that
+// trials remain independent. Parallel tempering swaps are done per lane.
+// Each lane holds a single replica per temperature, so there are no Houdayer
+// moves in this mode: pairing lanes would correlate independent trials.
+class MultiSpinLattice {
+   public:
+    MultiSpinLattice(Lattice* lattice, uint lanes = LANES);
+    MultiSpinLattice(const MultiSpinLattice&) = delete;
+    MultiSpinLattice& operator=(const MultiSpinLattice&) = delete;
+    ~MultiSpinLattice() { delete lattice; }
+
+    Lattice* getLattice() const { return lattice; }
+    const LatticeProperties& getProperties() const { return prop; }
+    uint getLanes() const { return lanes; }
+    uint getNumIndices() const { return prop.numIndices; }
+    uint getNumTemperatures() const { return prop.numT; }
+    double getTemperature(uint t) const { return temperatures[t]; }
+    const wvector& getSpinWords(uint t) const { return spins[t]; }
+    cvector getSpins(uint t, uint lane) const;
+
+    void monteCarloSweep();
+    void monteCarloSweep(uint t);
+    void parallelTemperingUpdate();
+    void update();
+    void reinit();
+    void seed(uint trial);
+
+    ivector getTotalEnergies(uint t) const;
+    dvector getMagnetizations(uint t) const;
+
+   private:
+    void generateTerms();
+    void generateProbabilities();
+    uint64_t findAcceptance(uint t, int weight, const uint64_t* sum,
+                            uint planes);
+    uint64_t randomWord();
+    void swapLanes(uint t1, uint t2, uint64_t mask);
+
+    Lattice* lattice;
+    const LatticeProperties& prop;
+    uint lanes;
+    uint64_t laneMask;
+
+    ivector siteWeights;
+    ivector siteTerms;
+    ivector termWeights;
+    wvector termSigns;
+    ivector termNeighbors;
+    ivector termIndices;
+    ivector energyWeights;
+    wvector energySigns;
+    ivector energyNeighbors;
+    ivector energyIndices;
+    uint sumPlanes;
+    int totalWeight;
+
+    dvector temperatures;
+    std::vector<std::vector<uint32_t>> probabilities;
+    std::vector<wvector> spins;
+    wvector levelMasks;
+    std::vector<uint32_t> levelProbabilities;
+    RandomGenerator gen;
+};
+}
+
+#endif /* MULTISPINLATTICE_H_ */
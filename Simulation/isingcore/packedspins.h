@@ -0,0 +1,110 @@
+#ifndef PACKEDSPINS_H_
+#define PACKEDSPINS_H_
+
+#include <cstdint>
+#include <vector>
+#include "common.h"
+#include "kernels.h"
+
+namespace ising {
+// Spins packed 64 to a word, bit i % 64 of word i / 64 set when index i is
+// down. Bits past the last index are kept clear so that popcounts over
+// whole words count indices only.
+class PackedSpins {
+   public:
+    PackedSpins() = default;
+    explicit PackedSpins(uint n) : size(n), words((n + 63) / 64, 0) {}
+    explicit PackedSpins(const cvector& spins) : PackedSpins(spins.size()) {
+        for (uint i = 0; i < size; ++i) {
+            if (spins[i] < 0) {
+                words[i >> 6] |= 1ULL << (i & 63);
+            }
+        }
+    }
+
+    uint getSize() const { return size; }
+    const wvector& getWords() const { return words; }
+    uint64_t* data() { return words.data(); }
+    const uint64_t* data() const { return words.data(); }
+
+    int get(uint i) const {
+        return 1 - 2 * (int)((words[i >> 6] >> (i & 63)) & 1);
+    }
+
+    void flip(uint i) { words[i >> 6] ^= 1ULL << (i & 63); }
+
+    void flipAll() {
+        for (auto& w : words) {
+            w = ~w;
+        }
+
+        clearTail();
+    }
+
+    uint countDown() const {
+        return getKernels().popcount(words.data(), words.size());
+    }
+
+    int sum() const { return (int)size - 2 * (int)countDown(); }
+
+    // Spin sum over the indices set in mask, which has the same layout
+    int sum(const wvector& mask, uint maskSize) const {
+        uint count =
+            getKernels().popcountAnd(words.data(), mask.data(), words.size());
+        return (int)maskSize - 2 * (int)count;
+    }
+
+    uint countDifferences(const PackedSpins& other) const {
+        return getKernels().popcountXor(words.data(), other.words.data(),
+                                        words.size());
+    }
+
+    cvector unpack() const {
+        cvector spins(size);
+
+        for (uint i = 0; i < size; ++i) {
+            spins[i] = (char)get(i);
+        }
+
+        return spins;
+    }
+
+   private:
+    void clearTail() {
+        if (size % 64 != 0) {
+            words.back() &= (1ULL << (size % 64)) - 1;
+        }
+    }
+
+    uint size = 0;
+    wvector words;
+};
+
+// Spin access shared by the sweep kernels, which are compiled once for each
+// storage: one char per index, or PackedSpins words. product(i, j) is the
+// two-spin product of a pairwise term.
+struct ByteSpinView {
+    char* spins;
+
+    int operator[](uint i) const { return spins[i]; }
+    int product(uint i, uint j) const { return spins[i] * spins[j]; }
+    void flip(uint i) { spins[i] = -spins[i]; }
+};
+
+struct PackedSpinView {
+    uint64_t* words;
+
+    int operator[](uint i) const {
+        return 1 - 2 * (int)((words[i >> 6] >> (i & 63)) & 1);
+    }
+    // From the parity of the two bits, without unpacking either spin
+    int product(uint i, uint j) const {
+        uint64_t bits = (words[i >> 6] >> (i & 63)) ^
+                        (words[j >> 6] >> (j & 63));
+        return 1 - 2 * (int)(bits & 1);
+    }
+    void flip(uint i) { words[i >> 6] ^= 1ULL << (i & 63); }
+};
+}
+
+#endif /* PACKEDSPINS_H_ */
@@ -0,0 +1,221 @@
+#include <thread>
+#include "populationannealing.h"
+
+using namespace ising;
+
+PopulationAnnealing::PopulationAnnealing(Lattice* lattice, uint population,
+                                         uint sweeps)
+    : lattice(lattice),
+      prop(lattice->getProperties()),
+      population(population),
+      sweeps(sweeps),
+      threads(1),
+      logPartition(0) {
+    if (population == 0) {
+        std::cout << "POPULATION ANNEALING NEEDS AT LEAST ONE REPLICA! "
+                  << "Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    Replica::checkReplicaMode(prop.mode, "POPULATION ANNEALING");
+
+    seed(0);
+}
+
+// Each replica of the initial population draws its streams from the
+// population stream of the trial; copies later draw theirs from the
+// replica they were copied from
+void PopulationAnnealing::seed(uint trial) {
+    gen.setStream(RandomGenerator::getRunSeed(),
+                  RandomGenerator::makeStream(trial, 0, POPULATION_STREAM));
+
+    walkers.resize(population);
+    gens.resize(population);
+    ancestors.resize(population);
+
+    for (uint j = 0; j < population; ++j) {
+        if (!walkers[j]) {
+            walkers[j] = std::make_shared<Replica>(prop, 0);
+        }
+
+        walkers[j]->seed(gen.randLong(), gen.randLong());
+        gens[j].setStream(gen.randLong(), gen.randLong());
+        ancestors[j] = j;
+    }
+
+    logPartition = prop.numIndices * log(2);
+}
+
+// Runs f(begin, end) over contiguous pieces of [0, size), one per thread
+template <class F>
+void PopulationAnnealing::forPopulation(uint size, F f) {
+    uint numThreads = std::min(threads, size);
+
+    if (numThreads <= 1) {
+        f(0U, size);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    for (uint k = 0; k < numThreads; ++k) {
+        uint begin = (uint64_t)size * k / numThreads;
+        uint end = (uint64_t)size * (k + 1) / numThreads;
+        workers.emplace_back(f, begin, end);
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// Copies each replica a number of times that rounds its share
+// population * w / sum(w) of the weights w = exp(-(1/t - 1/lastT) E) up or
+// down at random, and returns ln of the mean weight, the ratio of the
+// partition functions at t and lastT
+double PopulationAnnealing::resample(double t, double lastT) {
+    uint size = walkers.size();
+    double dBeta = 1 / t - (lastT > 0 ? 1 / lastT : 0);
+
+    int lowest = walkers[0]->getTotalEnergy();
+    for (auto& walker : walkers) {
+        lowest = std::min(lowest, walker->getTotalEnergy());
+    }
+
+    dvector weights(size);
+    forPopulation(size, [this, &weights, dBeta, lowest](uint begin,
+                                                         uint end) {
+        for (uint i = begin; i < end; ++i) {
+            weights[i] =
+                exp(-dBeta * (walkers[i]->getTotalEnergy() - lowest));
+        }
+    });
+
+    double sum = 0;
+    for (auto& w : weights) {
+        sum += w;
+    }
+
+    std::vector<uint32_t> copies(size);
+    forPopulation(size, [this, &weights, &copies, sum](uint begin,
+                                                       uint end) {
+        for (uint i = begin; i < end; ++i) {
+            double share = population * weights[i] / sum;
+            copies[i] = (uint32_t)share;
+
+            if (gens[i].randFloatCO() < share - copies[i]) {
+                copies[i]++;
+            }
+        }
+    });
+
+    // Copies of replica i go to [offsets[i], offsets[i + 1])
+    std::vector<uint32_t> offsets(size + 1, 0);
+    for (uint i = 0; i < size; ++i) {
+        offsets[i + 1] = offsets[i] + copies[i];
+    }
+
+    if (offsets[size] == 0) {
+        std::cout << "POPULATION DIED OUT! Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    replicavector nextWalkers(offsets[size]);
+    std::vector<RandomGenerator> nextGens(offsets[size]);
+    std::vector<uint32_t> nextAncestors(offsets[size]);
+
+    forPopulation(size, [&](uint begin, uint end) {
+        for (uint i = begin; i < end; ++i) {
+            for (uint c = 1; c < copies[i]; ++c) {
+                uint k = offsets[i] + c;
+                RandomGenerator& parentGen = gens[i];
+
+                nextWalkers[k] = std::make_shared<Replica>(*walkers[i]);
+                nextWalkers[k]->reseed(parentGen.randLong(),
+                                       parentGen.randLong());
+                nextGens[k].setStream(parentGen.randLong(),
+                                      parentGen.randLong());
+                nextAncestors[k] = ancestors[i];
+            }
+
+            if (copies[i] > 0) {
+                uint k = offsets[i];
+                nextWalkers[k] = std::move(walkers[i]);
+                nextGens[k] = gens[i];
+                nextAncestors[k] = ancestors[i];
+            }
+        }
+    });
+
+    walkers = std::move(nextWalkers);
+    gens = std::move(nextGens);
+    ancestors = std::move(nextAncestors);
+
+    return log(sum / size) - dBeta * lowest;
+}
+
+void PopulationAnnealing::measure(uint n, double t) {
+    double sumE = 0, sumE2 = 0, sumM = 0, sumM2 = 0, sumM4 = 0;
+
+    for (auto& walker : walkers) {
+        double e = walker->getTotalEnergy();
+        double m = std::abs(walker->getMagnetization());
+
+        sumE += e;
+        sumE2 += e * e;
+        sumM += m;
+        sumM2 += m * m;
+        sumM4 += m * m * m * m;
+    }
+
+    uint size = walkers.size();
+    double avgE = sumE / size;
+    double avgM2 = sumM2 / size;
+
+    std::vector<uint32_t> lineages = ancestors;
+    std::sort(lineages.begin(), lineages.end());
+
+    temperatures[n] = t;
+    freeEnergies[n] = -t * logPartition / prop.numIndices;
+    energies[n] = avgE / prop.numIndices;
+    specificHeats[n] =
+        (sumE2 / size - avgE * avgE) / (prop.numIndices * t * t);
+    magnetizations[n] = sumM / size;
+    binderCumulants[n] = 1 - sumM4 / size / (3 * avgM2 * avgM2);
+    families[n] = std::unique(lineages.begin(), lineages.end()) -
+                  lineages.begin();
+}
+
+// Moves the population from lastT to t and sweeps it there
+void PopulationAnnealing::anneal(double t, double lastT) {
+    logPartition += resample(t, lastT);
+
+    forPopulation(walkers.size(), [this, t](uint begin, uint end) {
+        for (uint i = begin; i < end; ++i) {
+            walkers[i]->setTemperatureUnchecked(t);
+
+            for (uint k = 0; k < sweeps; ++k) {
+                walkers[i]->update();
+            }
+        }
+    });
+}
+
+void PopulationAnnealing::run() {
+    double maxT = prop.minT + (prop.numT - 1) * prop.dT;
+    double lastT = 0;
+
+    // A single reweighting from infinite temperature would rest on the few
+    // random replicas of lowest energy
+    for (uint k = 1; k < WARMUP_STEPS; ++k) {
+        double t = maxT * WARMUP_STEPS / k;
+        anneal(t, lastT);
+        lastT = t;
+    }
+
+    for (int n = prop.numT - 1; n >= 0; --n) {
+        double t = prop.minT + n * prop.dT;
+        anneal(t, lastT);
+        lastT = t;
+        measure(n, t);
+    }
+}
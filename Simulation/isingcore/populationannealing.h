@@ -0,0 +1,70 @@
+#ifndef POPULATIONANNEALING_H_
+#define POPULATIONANNEALING_H_
+
+#include "lattices.h"
+
+namespace ising {
+// Equal steps in 1/T taken from infinite temperature to the highest
+// temperature of the lattice
+const uint WARMUP_STEPS = 32;
+
+// Population annealing through the temperatures of a lattice, from the
+// highest down to the lowest. A population of replicas starts from random
+// spins, which sample infinite temperature exactly. At each new temperature
+// every replica is copied a number of times drawn from its relative
+// Boltzmann weight, so the population keeps its nominal size on average,
+// then every copy is swept with the lattice's update mode. The population
+// is split among threads; each replica draws from its own random streams,
+// so results do not depend on the number of threads. The normalizations of
+// the weights give the free energy along the way.
+class PopulationAnnealing {
+   public:
+    PopulationAnnealing(Lattice* lattice, uint population, uint sweeps);
+    PopulationAnnealing(const PopulationAnnealing&) = delete;
+    PopulationAnnealing& operator=(const PopulationAnnealing&) = delete;
+    ~PopulationAnnealing() { delete lattice; }
+
+    Lattice* getLattice() const { return lattice; }
+    uint getPopulation() const { return walkers.size(); }
+    void setThreads(uint n) { threads = std::max(n, 1U); }
+    void seed(uint trial);
+    void run();
+
+    // Results by temperature, indexed as the lattice's temperatures
+    const dmap& getTemperatures() const { return temperatures; }
+    const dmap& getFreeEnergies() const { return freeEnergies; }
+    const dmap& getEnergies() const { return energies; }
+    const dmap& getSpecificHeats() const { return specificHeats; }
+    const dmap& getMagnetizations() const { return magnetizations; }
+    const dmap& getBinderCumulants() const { return binderCumulants; }
+    // Replicas of the initial population with descendants left
+    const dmap& getFamilies() const { return families; }
+
+   private:
+    template <class F>
+    void forPopulation(uint size, F f);
+    double resample(double t, double lastT);
+    void anneal(double t, double lastT);
+    void measure(uint n, double t);
+
+    Lattice* lattice;
+    const LatticeProperties& prop;
+    uint population;
+    uint sweeps;
+    uint threads;
+    replicavector walkers;
+    std::vector<RandomGenerator> gens;
+    std::vector<uint32_t> ancestors;
+    double logPartition;
+    dmap temperatures;
+    dmap freeEnergies;
+    dmap energies;
+    dmap specificHeats;
+    dmap magnetizations;
+    dmap binderCumulants;
+    dmap families;
+    RandomGenerator gen;
+};
+}
+
+#endif /* POPULATIONANNEALING_H_ */
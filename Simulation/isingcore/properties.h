@@ -1,10 +1,34 @@
 #ifndef PROPERTIES_H_
 #define PROPERTIES_H_
 
+#include <cstdint>
 #include "common.h"
 #include "hamiltonian.h"
+#include "indexorder.h"
+#include "stencils.h"
 
 namespace ising {
+// Flattened copy of indInteractions: the terms of index i are
+// [siteOffsets[i], siteOffsets[i + 1]), and the other indices of term k are
+// neighbors[termOffsets[k]] up to neighbors[termOffsets[k + 1]]. When every
+// term is pairwise, termOffsets[k] == k and kernels may skip it. For k-body
+// Hamiltonians, termIds[k] numbers the distinct term behind entry k (shared
+// by the entries of all its indices) and termCouplings holds one coupling
+// per distinct term. Couplings are narrowed to int16_t; indices may number
+// more than 2^16, so offsets and neighbors keep 32 bits. Hamiltonians with
+// real couplings keep them in realCouplings, entry for entry, and couplings
+// only holds their signs.
+struct CompiledInteractions {
+    std::vector<uint32_t> siteOffsets;
+    std::vector<int16_t> couplings;
+    fvector realCouplings;
+    std::vector<uint32_t> termOffsets;
+    std::vector<uint32_t> neighbors;
+    std::vector<uint32_t> termIds;
+    std::vector<int16_t> termCouplings;
+    bool pairwise = true;
+};
+
 struct LatticeProperties {
     LatticeProperties(Hamiltonian h, double t, double dt, uint n, char m)
         : hamiltonian(h),
@@ -15,16 +39,30 @@ struct LatticeProperties {
           minT(t),
           dT(dt),
           numT(n),
-          mode(m) {}
+          mode(m),
+          indexOrder(NATURAL_ORDER),
+          maxIndexEnergy(0),
+          nFoldTemperature(0),
+          localFields(false),
+          packedSpins(false),
+          termSigns(false),
+          sweepThreads(1) {}
     ~LatticeProperties() {}
 
     const Hamiltonian hamiltonian;
     const uint numIndices;
     ivector indices;
+    // Original label of each index, and the index of each original label
+    // taken in sorted order
+    ivector originalIndices;
+    ivector labelPositions;
     ivector2 hFunction;
     ivector2 localTerms;
     i2arrayvector locations;
     ivector3 indInteractions;
+    CompiledInteractions interactions;
+    StencilInteractions stencil;
+    ivector2 colorClasses;
     ivector2 xDisplacements;
     ivector2 yDisplacements;
     dvector2 distances;
@@ -38,6 +76,14 @@ struct LatticeProperties {
     const double dT;
     const uint numT;
     char mode;
+    char indexOrder;
+    int maxIndexEnergy;
+    // Replicas below this temperature update by the n-fold way
+    double nFoldTemperature;
+    bool localFields;
+    bool packedSpins;
+    bool termSigns;
+    uint sweepThreads;
 };
 }
 
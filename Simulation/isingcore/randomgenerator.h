@@ -1,39 +1,216 @@
 #ifndef RANDOMGENERATOR_H_
 #define RANDOMGENERATOR_H_
 
-#include <stdlib.h>
-#include <time.h>
+#include <stdint.h>
+#include <atomic>
+#include <iostream>
+#include <random>
 
 namespace ising {
+// Streams with the top bit set are handed out to generators that were never
+// seeded explicitly; explicit streams come from makeStream.
+const uint64_t ANONYMOUS_STREAM = 1ULL << 63;
+const uint32_t LATTICE_STREAM = 0xFF;
+const uint32_t ARENA_STREAM = 0xFE;
+const uint32_t POPULATION_STREAM = 0xFD;
+const uint32_t DOMAIN_WALL_STREAM = 0xFC;
+
+// Counter-based Philox4x32-10 generator. Block n of stream s under run seed
+// k is a pure function of (k, s, n), so every (trial, temperature, replica)
+// gets an independent, reproducible stream, and no state is shared between
+// threads.
 class RandomGenerator {
    public:
-    RandomGenerator() {
-        unsigned int zFactor = (unsigned int)reinterpret_cast<intptr_t>(&zSeed);
-        unsigned int wFactor = (unsigned int)reinterpret_cast<intptr_t>(&wSeed);
+    RandomGenerator() : RandomGenerator(getRunSeed(), nextAnonymousStream()) {}
+    RandomGenerator(uint64_t seed, uint64_t stream) { setStream(seed, stream); }
+
+    void setStream(uint64_t seed, uint64_t stream) {
+        key[0] = (uint32_t)seed;
+        key[1] = (uint32_t)(seed >> 32);
+        counter[0] = 0;
+        counter[1] = 0;
+        counter[2] = (uint32_t)stream;
+        counter[3] = (uint32_t)(stream >> 32);
+        position = BLOCK;
+    }
+
+    inline uint32_t randInt() {
+        if (position == BLOCK) {
+            generateBlock();
+        }
+
+        return block[position++];
+    }
+
+    inline uint64_t randLong() {
+        return ((uint64_t)randInt() << 32) | randInt();
+    }
+
+    float randFloatCO() {
+        return asFloat(0x3F800000U | (randInt() >> 9)) - 1.0f;
+    }
+
+    // Same sequence as n calls of randFloatCO. The buffered block is used up
+    // first, then BATCH blocks at a time are generated with their rounds
+    // interleaved, so that the multiplications of one block overlap those of
+    // the other, and converted without going through the buffer.
+    void fillFloatCO(float* out, size_t n) {
+        size_t i = 0;
 
-        srand((unsigned int)time(NULL) + (zFactor ^ wFactor) / zFactor);
-        zSeed = rand() + (zFactor & rand());
-        wSeed = rand() - (wFactor | rand());
+        for (; i < n && position < BLOCK; ++i) {
+            out[i] = randFloatCO();
+        }
+
+        uint32_t bits[BATCH * BLOCK];
+        for (; n - i >= BATCH * BLOCK; i += BATCH * BLOCK) {
+            generateBlocks(bits);
+
+            for (uint32_t j = 0; j < BATCH * BLOCK; ++j) {
+                out[i + j] = asFloat(0x3F800000U | (bits[j] >> 9)) - 1.0f;
+            }
+        }
+
+        for (; i < n; ++i) {
+            out[i] = randFloatCO();
+        }
     }
 
-    inline unsigned int MWC() { return (zNew() << 16) + wNew(); }
-    float randFloatCO() { return asFloat(0x3F800000U | (MWC() >> 9)) - 1.0f; }
+    // The state is the key, the counter of the next block and the position
+    // within the buffered one; the buffer itself is regenerated on load
+    void save(std::ostream& out) const {
+        out << key[0] << " " << key[1] << " " << counter[0] << " "
+            << counter[1] << " " << counter[2] << " " << counter[3] << " "
+            << position << "\n";
+    }
+
+    void load(std::istream& in) {
+        in >> key[0] >> key[1] >> counter[0] >> counter[1] >> counter[2] >>
+            counter[3] >> position;
+
+        // The saved counter already points past the buffered block
+        if (position < BLOCK) {
+            uint32_t next = position;
+            stepBack();
+            generateBlock();
+            position = next;
+        }
+    }
+
+    static uint64_t makeStream(uint32_t trial, uint32_t temperature,
+                               uint32_t replica) {
+        return ((uint64_t)trial << 32) | ((uint64_t)temperature << 8) |
+               (replica & 0xFF);
+    }
+
+    static uint64_t getRunSeed() { return runSeed(); }
+    static void setRunSeed(uint64_t seed) { runSeed() = seed; }
 
    private:
-    unsigned int zSeed;
-    unsigned int wSeed;
+    static const uint32_t BLOCK = 4;
+    // Blocks interleaved by fillFloatCO; more spill registers on x86-64
+    static const uint32_t BATCH = 2;
+
+    uint32_t key[2];
+    uint32_t counter[4];
+    uint32_t block[BLOCK];
+    uint32_t position;
 
-    inline unsigned int zNew() {
-        return zSeed = 36969 * (zSeed & 65535) + (zSeed >> 16);
+    static std::atomic<uint64_t>& runSeed() {
+        static std::atomic<uint64_t> seed(
+            ((uint64_t)std::random_device()() << 32) | std::random_device()());
+        return seed;
     }
 
-    inline unsigned int wNew() {
-        return wSeed = 18000 * (wSeed & 65535) + (wSeed >> 16);
+    static uint64_t nextAnonymousStream() {
+        static std::atomic<uint64_t> streams(0);
+        return ANONYMOUS_STREAM | streams++;
     }
 
-    float asFloat(unsigned int i) {
+    static inline uint32_t mulhilo(uint32_t a, uint32_t b, uint32_t& hi) {
+        uint64_t product = (uint64_t)a * b;
+        hi = (uint32_t)(product >> 32);
+        return (uint32_t)product;
+    }
+
+    void generateBlock() {
+        uint32_t c[4] = {counter[0], counter[1], counter[2], counter[3]};
+        uint32_t k[2] = {key[0], key[1]};
+
+        for (int round = 0; round < 10; ++round) {
+            uint32_t hi0, hi1;
+            uint32_t lo0 = mulhilo(0xD2511F53U, c[0], hi0);
+            uint32_t lo1 = mulhilo(0xCD9E8D57U, c[2], hi1);
+
+            c[0] = hi1 ^ c[1] ^ k[0];
+            c[1] = lo1;
+            c[2] = hi0 ^ c[3] ^ k[1];
+            c[3] = lo0;
+
+            k[0] += 0x9E3779B9U;
+            k[1] += 0xBB67AE85U;
+        }
+
+        for (uint32_t i = 0; i < BLOCK; ++i) {
+            block[i] = c[i];
+        }
+
+        position = 0;
+        if (++counter[0] == 0) {
+            ++counter[1];
+        }
+    }
+
+    // Blocks of the next BATCH counters, written in stream order to out,
+    // leaving any buffered block untouched
+    void generateBlocks(uint32_t* out) {
+        uint32_t c0[BATCH], c1[BATCH], c2[BATCH], c3[BATCH];
+
+        for (uint32_t b = 0; b < BATCH; ++b) {
+            c0[b] = counter[0];
+            c1[b] = counter[1];
+            c2[b] = counter[2];
+            c3[b] = counter[3];
+
+            if (++counter[0] == 0) {
+                ++counter[1];
+            }
+        }
+
+        uint32_t k0 = key[0];
+        uint32_t k1 = key[1];
+
+        for (int round = 0; round < 10; ++round) {
+            for (uint32_t b = 0; b < BATCH; ++b) {
+                uint64_t p0 = (uint64_t)0xD2511F53U * c0[b];
+                uint64_t p1 = (uint64_t)0xCD9E8D57U * c2[b];
+
+                c0[b] = (uint32_t)(p1 >> 32) ^ c1[b] ^ k0;
+                c1[b] = (uint32_t)p1;
+                c2[b] = (uint32_t)(p0 >> 32) ^ c3[b] ^ k1;
+                c3[b] = (uint32_t)p0;
+            }
+
+            k0 += 0x9E3779B9U;
+            k1 += 0xBB67AE85U;
+        }
+
+        for (uint32_t b = 0; b < BATCH; ++b) {
+            out[b * BLOCK] = c0[b];
+            out[b * BLOCK + 1] = c1[b];
+            out[b * BLOCK + 2] = c2[b];
+            out[b * BLOCK + 3] = c3[b];
+        }
+    }
+
+    void stepBack() {
+        if (counter[0]-- == 0) {
+            --counter[1];
+        }
+    }
+
+    float asFloat(uint32_t i) {
         union {
-            unsigned int i;
+            uint32_t i;
             float f;
         } pun = {i};
         return pun.f;
@@ -46,17 +223,6 @@ class RandomGenerator {
 /**
         Credits to Andy Gainey
    (https://experilous.com/1/blog/post/perfect-fast-random-floating-point-numbers)
-        and George Marsaglia (http://www.cse.yorku.ca/~oz/marsaglia-rng.html)
-        for algoritms behind randFloatCO and MWC, respectively, used in random
-        number generation.
+        for the algorithm behind randFloatCO, and to Salmon et al., "Parallel
+        Random Numbers: As Easy as 1, 2, 3" (SC11) for Philox4x32-10.
 */
-
-/**
-        Variables for better random generator:
-        #include <random>
-        std::random_device rd;
-        std::mt19937 gen;
-        std::uniform_int_distribution<> randSpin;
-        std::uniform_real_distribution<> randProb;
-        std::uniform_int_distribution<> randInd;
-*/
\ No newline at end of file
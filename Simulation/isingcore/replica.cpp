@@ -1,18 +1,295 @@
+#include <atomic>
+#include <cassert>
 #include "replica.h"
+#include "threadpoolhelpers.h"
 
 using namespace ising;
 
 Replica::Replica(const LatticeProperties& properties, uint n)
-    : prop(properties), replicaIndex(n) {
+    : prop(properties),
+      replicaIndex(n),
+      realEnergy(0),
+      realSweeps(0),
+      stamp(0),
+      classLeaves(0),
+      demonEnergySum(0),
+      demonSamples(0) {
     temperature = prop.minT + replicaIndex * prop.dT;
+    generateProbabilities();
     randomizedIndices = prop.indices;
-    spins.resize(prop.numIndices);
+    useFields = prop.localFields;
+    useSigns = prop.termSigns;
+    usePacked = prop.packedSpins;
+    useReal = !prop.interactions.realCouplings.empty();
     initSpins();
 }
 
+// Runs f on a view of whichever storage the replica uses
+template <class F>
+auto Replica::withSpins(F f) {
+    if (usePacked) {
+        return f(PackedSpinView{packed.data()});
+    }
+
+    return f(ByteSpinView{spins.data()});
+}
+
+// Runs f on a view of the spins and a value of the coupling type, whose
+// type picks the kernels compiled for it
+template <class F>
+void Replica::withKernels(F f) {
+    withSpins([this, &f](auto s) {
+        if (useReal) {
+            f(s, float());
+        } else {
+            f(s, int16_t());
+        }
+    });
+}
+
+template <>
+const int16_t* Replica::couplingsOf<int16_t>() const {
+    return prop.interactions.couplings.data();
+}
+
+template <>
+const float* Replica::couplingsOf<float>() const {
+    return prop.interactions.realCouplings.data();
+}
+
+template <>
+ivector& Replica::fieldsOf<int16_t>() {
+    return fields;
+}
+
+template <>
+fvector& Replica::fieldsOf<float>() {
+    return realFields;
+}
+
+template <>
+int& Replica::energyOf<int16_t>() {
+    return totalEnergy;
+}
+
+template <>
+double& Replica::energyOf<float>() {
+    return realEnergy;
+}
+
+template <>
+ivector& Replica::colorEnergiesOf<int16_t>() {
+    return colorEnergies;
+}
+
+template <>
+fvector& Replica::colorEnergiesOf<float>() {
+    return realColorEnergies;
+}
+
+// Both storages draw the same sequence, so a seeded trial does not depend
+// on how its spins are stored
 void Replica::initSpins() {
-    for (auto& s : spins) {
-        s = (gen.MWC() % 2 == 0) ? 1 : -1;
+    cvector drawn(prop.numIndices);
+    for (auto& s : drawn) {
+        s = (gen.randInt() % 2 == 0) ? 1 : -1;
+    }
+
+    if (usePacked) {
+        packed = PackedSpins(drawn);
+    } else {
+        spins = std::move(drawn);
+    }
+
+    if (useFields) {
+        initFields();
+    }
+
+    if (useSigns) {
+        initSigns();
+    }
+
+    initTotals();
+}
+
+void Replica::seed(uint64_t runSeed, uint64_t stream) {
+    gen.setStream(runSeed, stream);
+    initSpins();
+}
+
+// Copies a configuration held elsewhere (every stride-th char of s) whose
+// totals are already known
+void Replica::loadSpins(const char* s, uint stride, int energy, int sum) {
+    withSpins([this, s, stride](auto v) {
+        for (uint i = 0; i < prop.numIndices; ++i) {
+            if (v[i] != s[i * stride]) {
+                v.flip(i);
+            }
+        }
+    });
+
+    totalEnergy = energy;
+    spinSum = sum;
+
+    if (useFields) {
+        initFields();
+    }
+
+    if (useSigns) {
+        initSigns();
+    }
+}
+
+void Replica::initTotals() {
+    withKernels([this](auto s, auto j) {
+        typedef decltype(j) J;
+        energyOf<J>() = findTotalEnergy<J>(s);
+    });
+
+    if (usePacked) {
+        spinSum = packed.sum();
+    } else {
+        spinSum = getKernels().sumChars(spins.data(), spins.size());
+    }
+}
+
+// Number of indices at which this configuration differs from other, so the
+// overlap of the two is numIndices minus twice this
+uint Replica::countDifferences(const Replica& other) const {
+    if (usePacked && other.usePacked) {
+        return packed.countDifferences(other.packed);
+    } else if (!usePacked && !other.usePacked) {
+        return getKernels().countDifferentChars(spins.data(),
+                                                other.spins.data(),
+                                                spins.size());
+    }
+
+    uint count = 0;
+    for (uint i = 0; i < prop.numIndices; ++i) {
+        count += getSpin(i) != other.getSpin(i);
+    }
+
+    return count;
+}
+
+// Spin sum over the indices set in mask, which has the PackedSpins layout.
+// Byte storage visits the set bits directly rather than packing a copy.
+int Replica::getSpinSum(const wvector& mask, uint maskSize) const {
+    if (usePacked) {
+        return packed.sum(mask, maskSize);
+    }
+
+    int sum = 0;
+    for (uint w = 0; w < mask.size(); ++w) {
+        for (uint64_t bits = mask[w]; bits != 0; bits &= bits - 1) {
+            sum += spins[w * 64 + __builtin_ctzll(bits)];
+        }
+    }
+
+    return sum;
+}
+
+void Replica::setLocalFields(bool enable) {
+    useFields = enable;
+
+    if (useFields) {
+        initFields();
+    } else {
+        fields.clear();
+        realFields.clear();
+    }
+}
+
+void Replica::setTermSigns(bool enable) {
+    useSigns = enable;
+
+    if (useSigns) {
+        initSigns();
+    } else {
+        signs.clear();
+    }
+}
+
+void Replica::setPackedSpins(bool enable) {
+    if (enable == usePacked) {
+        return;
+    }
+
+    if (enable) {
+        packed = PackedSpins(spins);
+        cvector().swap(spins);
+    } else {
+        spins = packed.unpack();
+        packed = PackedSpins();
+    }
+
+    usePacked = enable;
+}
+
+void Replica::initFields() {
+    withKernels([this](auto s, auto j) {
+        typedef decltype(j) J;
+        auto& f = fieldsOf<J>();
+        f.resize(prop.numIndices);
+
+        for (uint i = 0; i < prop.numIndices; ++i) {
+            f[i] = findIndexField<J>(s, i);
+        }
+    });
+}
+
+// Each distinct term is written once per index it contains; the writes
+// agree, so no bookkeeping is needed to visit it once
+void Replica::initSigns() {
+    const CompiledInteractions& in = prop.interactions;
+    signs.resize(in.termCouplings.size());
+
+    withSpins([this, &in](auto s) {
+        for (uint i = 0; i < prop.numIndices; ++i) {
+            for (uint32_t k = in.siteOffsets[i]; k < in.siteOffsets[i + 1];
+                 ++k) {
+                int sign = s[i];
+
+                for (uint32_t n = in.termOffsets[k]; n < in.termOffsets[k + 1];
+                     ++n) {
+                    sign *= s[in.neighbors[n]];
+                }
+
+                signs[in.termIds[k]] = (char)sign;
+            }
+        }
+    });
+}
+
+// Called after spins[index] has been flipped. Every term containing index
+// changes sign, which moves the field of each other index in the term by
+// twice the new term value.
+template <class J, class V>
+void Replica::updateFields(V s, int index) {
+    const CompiledInteractions& in = prop.interactions;
+    const J* couplings = couplingsOf<J>();
+    Field<J>* f = fieldsOf<J>().data();
+
+    uint32_t end = in.siteOffsets[index + 1];
+    if (in.pairwise) {
+        Field<J> twice = 2 * s[index];
+        for (uint32_t k = in.siteOffsets[index]; k < end; ++k) {
+            f[in.neighbors[k]] += twice * couplings[k];
+        }
+    } else {
+        for (uint32_t k = in.siteOffsets[index]; k < end; ++k) {
+            Field<J> term = couplings[k] * s[index];
+
+            for (uint32_t n = in.termOffsets[k]; n < in.termOffsets[k + 1];
+                 ++n) {
+                term *= s[in.neighbors[n]];
+            }
+
+            for (uint32_t n = in.termOffsets[k]; n < in.termOffsets[k + 1];
+                 ++n) {
+                f[in.neighbors[n]] += 2 * term * s[in.neighbors[n]];
+            }
+        }
     }
 }
 
@@ -22,19 +299,77 @@ void Replica::setTemperature(double t) {
         exit(EXIT_FAILURE);
     }
 
+    setTemperatureUnchecked(t);
+}
+
+void Replica::setTemperatureUnchecked(double t) {
     temperature = t;
+    generateProbabilities();
+    demonEnergySum = 0;
+    demonSamples = 0;
+}
+
+// Index energies are integers bounded by prop.maxIndexEnergy, so the
+// Boltzmann factor of every uphill flip is tabulated once per temperature.
+// Couplings are bounded the same way, so are the Wolff bond probabilities.
+void Replica::generateProbabilities() {
+    probabilities.resize(prop.maxIndexEnergy + 1);
+    bondProbabilities.resize(prop.maxIndexEnergy + 1);
+
+    for (int e = 0; e <= prop.maxIndexEnergy; ++e) {
+        probabilities[e] = pow(E, (-1 / getTemperature()) * (2 * e));
+        bondProbabilities[e] = 1 - probabilities[e];
+    }
 }
 
 void Replica::update() {
+    if (useReal) {
+        withSpins([this](auto s) { updateReal(s); });
+    } else {
+        withSpins([this](auto s) { update(s); });
+    }
+}
+
+// Multi-spin lattices sweep in their own engine, so their replicas have no
+// update of their own
+void Replica::checkReplicaMode(char mode, const std::string& engine) {
+    if (mode == MULTISPIN) {
+        std::cout << engine << " HAS NO MULTI-SPIN REPLICA UPDATE! "
+                  << "Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+}
+
+template <class V>
+void Replica::update(V s) {
+    if (temperature < prop.nFoldTemperature) {
+        updateNFold(s);
+        return;
+    }
+
     switch (prop.mode) {
+        // A lone replica of a vectorized lattice sweeps in the same order
         case ALL:
-            updateAll();
+        case VECTORIZED:
+            updateAll(s);
             break;
         case PSEUDO:
-            updatePseudo();
+            updatePseudo(s);
             break;
         case RANDOM:
-            updateRandom();
+            updateRandom(s);
+            break;
+        case COLORED:
+            updateColored(s);
+            break;
+        case WOLFF:
+            updateWolff(s);
+            break;
+        case SWENDSEN_WANG:
+            updateSwendsenWang(s);
+            break;
+        case DEMON:
+            updateDemon(s);
             break;
         default:
             std::cout << "INVALID MODE! Exiting...\n\n";
@@ -42,97 +377,836 @@ void Replica::update() {
     }
 }
 
-void Replica::updateAll() {
+// Real couplings have no acceptance tables, so only the Metropolis sweeps
+// run for them, comparing against drawn thresholds. The lattice has already
+// turned away other modes.
+template <class V>
+void Replica::updateReal(V s) {
+    if (temperature < prop.nFoldTemperature) {
+        std::cout << "N-FOLD UPDATES NEED INTEGER COUPLINGS! Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    switch (prop.mode) {
+        case ALL:
+            updateAll<float>(s);
+            break;
+        case PSEUDO:
+            updatePseudo<float>(s);
+            break;
+        case RANDOM:
+            updateRandom<float>(s);
+            break;
+        case COLORED:
+            updateColored<float>(s);
+            break;
+        default:
+            std::cout << "INVALID MODE! Exiting...\n\n";
+            exit(EXIT_FAILURE);
+    }
+
+    if (++realSweeps % REAL_REFRESH_SWEEPS == 0) {
+        if (useFields) {
+            initFields();
+        }
+
+        initTotals();
+    }
+}
+
+template <class J, class V>
+void Replica::updateAll(V s) {
+    // Cached local fields already make each acceptance test one lookup
+    if constexpr (std::is_integral<J>::value) {
+        switch (useFields ? NO_STENCIL : prop.stencil.kind) {
+            case SQUARE_NN:
+                return updateStencil<SQUARE_NN>(s);
+            case TRIANGLE_NN:
+                return updateStencil<TRIANGLE_NN>(s);
+            case SQUARE_NNN:
+                return updateStencil<SQUARE_NNN>(s);
+            case TRIANGLE_NNN:
+                return updateStencil<TRIANGLE_NNN>(s);
+        }
+    }
+
+    drawThresholds<J>();
     for (uint i = 0; i < prop.numIndices; ++i) {
-        if (findProbability(i) > gen.randFloatCO()) {
-            spins[i] *= -1;
+        Field<J> energy = findIndexEnergy<J>(s, i);
+        if (acceptFlip(energy, i)) {
+            flip<J>(s, i, energy);
+        }
+    }
+}
+
+// Row-major sweep of a periodic lattice matched to stencil S. Neighbors
+// come from the starts of the rows within reach, and only columns within
+// reach of an edge pay for wrapping.
+template <int S, class V>
+void Replica::updateStencil(V s) {
+    typedef Stencil<S> St;
+    const int bonds = 2 * St::FORWARD;
+    const int rows = prop.hamiltonian.getRows();
+    const int cols = prop.hamiltonian.getCols();
+    const int8_t* couplings = prop.stencil.couplings.data();
+    const int* columns = prop.stencil.columns.data() + St::REACH;
+    int rowStarts[2 * St::REACH + 1];
+
+    for (int r = 0; r < rows; ++r) {
+        for (int dr = -St::REACH; dr <= St::REACH; ++dr) {
+            rowStarts[St::REACH + dr] = ((r + dr + rows) % rows) * cols;
+        }
+
+        for (int c = 0; c < cols; ++c) {
+            int index = r * cols + c;
+            const int8_t* j = couplings + index * bonds;
+
+            int field;
+            if (c < St::REACH || c >= cols - St::REACH) {
+                field = findStencilField<S, true>(s, j, rowStarts, columns, c);
+            } else {
+                field = findStencilField<S, false>(s, j, rowStarts, columns, c);
+            }
+
+            int energy = -s[index] * field;
+            if (acceptFlip(energy)) {
+                flip(s, index, energy);
+            }
         }
     }
 }
 
-void Replica::updatePseudo() {
+template <class J, class V>
+void Replica::updatePseudo(V s) {
     for (uint i = 0; i < prop.numIndices; ++i) {
-        int j = gen.MWC() % prop.numIndices;
+        int j = gen.randInt() % prop.numIndices;
         std::swap(randomizedIndices[i], randomizedIndices[j]);
     }
 
+    drawThresholds<J>();
     for (uint i = 0; i < prop.numIndices; ++i) {
         int index = randomizedIndices[i];
-        if (findProbability(index) > gen.randFloatCO()) {
-            spins[index] *= -1;
+        Field<J> energy = findIndexEnergy<J>(s, index);
+        if (acceptFlip(energy, i)) {
+            flip<J>(s, index, energy);
         }
     }
 }
 
-void Replica::updateRandom() {
+template <class J, class V>
+void Replica::updateRandom(V s) {
     int index;
 
+    drawThresholds<J>();
     for (uint i = 0; i < prop.numIndices; ++i) {
-        index = prop.indices[gen.MWC() % prop.numIndices];
+        index = prop.indices[gen.randInt() % prop.numIndices];
 
-        if (findProbability(index) > gen.randFloatCO()) {
-            spins[index] *= -1;
+        Field<J> energy = findIndexEnergy<J>(s, index);
+        if (acceptFlip(energy, i)) {
+            flip<J>(s, index, energy);
         }
     }
 }
 
-double Replica::findProbability(int index) {
-    int initEnergy = findIndexEnergy(index);
+// Indices of one color never share a term, so the energies and acceptances
+// of a whole class depend only on other classes. Uniforms are drawn for the
+// class up front, acceptances are found in bulk (split across the sweep
+// pool for large classes), and the accepted flips are applied afterwards.
+// Real couplings turn the uniforms into thresholds as they are drawn.
+template <class J, class V>
+void Replica::updateColored(V s) {
+    auto& energies = colorEnergiesOf<J>();
+
+    for (auto& colorClass : prop.colorClasses) {
+        uint size = colorClass.size();
+        energies.resize(size);
+        colorUniforms.resize(size);
+        colorAccepted.resize(size);
+
+        gen.fillFloatCO(colorUniforms.data(), size);
+        if (!std::is_integral<J>::value) {
+            getKernels().findThresholds(colorUniforms.data(),
+                                        temperature / 2, size);
+        }
+
+        uint threads = std::min(prop.sweepThreads, size / COLOR_CHUNK);
+        if (threads > 1) {
+            uint chunk = (size + threads - 1) / threads;
+
+            runSweepTasks(threads, [this, s, &colorClass, chunk, size](uint k) {
+                uint begin = std::min(k * chunk, size);
+                uint end = std::min(begin + chunk, size);
+                findColorAcceptances<J>(s, colorClass, begin, end);
+            });
+        } else {
+            findColorAcceptances<J>(s, colorClass, 0, size);
+        }
+
+        for (uint n = 0; n < size; ++n) {
+            if (colorAccepted[n]) {
+                flip<J>(s, colorClass[n], energies[n]);
+            }
+        }
+    }
+}
+
+// Wolff single-cluster moves. Growing from a random index, a satisfied bond
+// of coupling J adds its other index with probability 1 - exp(-2|J| / T).
+// Indices are flipped as they join, so a bond that was satisfied before its
+// index flipped is one with J * s_i * s_j < 0.
+//
+// An update flips about as many indices as a sweep. Stopping once enough
+// indices have flipped would bias measurements, so the number of clusters is
+// fixed beforehand from the mean cluster size seen so far at the current
+// temperature, which settles as the run goes on. The stack, stamps and
+// cluster statistics are sized once and reused.
+template <class V>
+void Replica::updateWolff(V s) {
+    const CompiledInteractions& in = prop.interactions;
+    const double* p = bondProbabilities.data();
+
+    if (!in.pairwise) {
+        std::cout << "WOLFF MODE NEEDS A PAIRWISE HAMILTONIAN! Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    clusterStack.reserve(prop.numIndices);
+    visitStamps.resize(prop.numIndices);
+    wolffClusters.resize(prop.numT);
+    wolffFlips.resize(prop.numT);
+
+    uint slot = 0;
+    if (prop.dT > 0) {
+        slot = std::min((uint)std::lround((temperature - prop.minT) / prop.dT),
+                        prop.numT - 1);
+    }
+
+    uint64_t numClusters = 1;
+    if (wolffFlips[slot] > 0) {
+        numClusters = std::max<uint64_t>(
+            1, prop.numIndices * wolffClusters[slot] / wolffFlips[slot]);
+    }
+
+    for (uint64_t c = 0; c < numClusters; ++c) {
+        if (++stamp == 0) {
+            std::fill(visitStamps.begin(), visitStamps.end(), 0);
+            stamp = 1;
+        }
+
+        int start = gen.randInt() % prop.numIndices;
+        visitStamps[start] = stamp;
+        clusterStack.assign(1, start);
+        flip(s, start, findIndexEnergy(s, start));
+        ++wolffFlips[slot];
+
+        while (!clusterStack.empty()) {
+            int i = clusterStack.back();
+            clusterStack.pop_back();
+
+            for (uint32_t k = in.siteOffsets[i]; k < in.siteOffsets[i + 1];
+                 ++k) {
+                int j = in.neighbors[k];
+                int bond = in.couplings[k] * s[i] * s[j];
 
-    if (initEnergy < 0) {
-        return pow(E, (-1 / getTemperature()) * (-2 * initEnergy));
+                if (bond < 0 && visitStamps[j] != stamp &&
+                    p[-bond] > gen.randFloatCO()) {
+                    visitStamps[j] = stamp;
+                    clusterStack.push_back(j);
+                    flip(s, j, findIndexEnergy(s, j));
+                    ++wolffFlips[slot];
+                }
+            }
+        }
+    }
+
+    wolffClusters[slot] += numClusters;
+}
+
+// Lock-free union-find over parent links, shared between threads through
+// atomic builtins. Roots are only ever linked below smaller roots, so
+// parents never increase and the root of every cluster is its smallest
+// index, whichever thread linked it. Finding halves the path.
+static uint32_t findCluster(uint32_t* parents, uint32_t i) {
+    while (true) {
+        uint32_t p = __atomic_load_n(&parents[i], __ATOMIC_RELAXED);
+        if (p == i) {
+            return i;
+        }
+
+        uint32_t grandparent = __atomic_load_n(&parents[p], __ATOMIC_RELAXED);
+        if (grandparent != p) {
+            __atomic_compare_exchange_n(&parents[i], &p, grandparent, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        }
+
+        i = grandparent;
+    }
+}
+
+static void uniteClusters(uint32_t* parents, uint32_t a, uint32_t b) {
+    while (true) {
+        a = findCluster(parents, a);
+        b = findCluster(parents, b);
+
+        if (a == b) {
+            return;
+        }
+
+        if (a < b) {
+            std::swap(a, b);
+        }
+
+        uint32_t root = a;
+        if (__atomic_compare_exchange_n(&parents[a], &root, b, false,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return;
+        }
+    }
+}
+
+// Runs f(begin, end) over ranges of indices split across the sweep pool.
+// Ranges start at multiples of 64 so that no two share a word of packed
+// spins.
+template <class F>
+void Replica::forClusterChunks(F f) {
+    uint n = prop.numIndices;
+    uint threads = std::min(prop.sweepThreads, n / CLUSTER_CHUNK);
+
+    if (threads <= 1) {
+        f(0, n);
+        return;
+    }
+
+    uint chunk = ((n + threads - 1) / threads + 63) / 64 * 64;
+
+    runSweepTasks(threads, [f, n, chunk](uint k) mutable {
+        uint begin = std::min(k * chunk, n);
+        f(begin, std::min(begin + chunk, n));
+    });
+}
+
+// Swendsen-Wang moves. Every satisfied bond of coupling J is activated with
+// probability 1 - exp(-2|J| / T), clusters of active bonds are labelled by
+// union-find and each cluster is flipped on a coin toss. Uniforms and coins
+// are drawn up front, a coin per root index, so the passes over the indices
+// can run on several threads and still give the same result as one. The
+// totals are summed again afterwards.
+template <class V>
+void Replica::updateSwendsenWang(V s) {
+    const CompiledInteractions& in = prop.interactions;
+    const double* p = bondProbabilities.data();
+    const uint n = prop.numIndices;
+
+    if (!in.pairwise) {
+        std::cout << "SWENDSEN-WANG MODE NEEDS A PAIRWISE HAMILTONIAN! "
+                     "Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    clusterParents.resize(n);
+    bondUniforms.resize(in.neighbors.size());
+    clusterCoins.resize((n + 63) / 64);
+
+    gen.fillFloatCO(bondUniforms.data(), bondUniforms.size());
+    for (auto& word : clusterCoins) {
+        word = gen.randLong();
+    }
+
+    uint32_t* parents = clusterParents.data();
+    const float* u = bondUniforms.data();
+    const uint64_t* coins = clusterCoins.data();
+
+    forClusterChunks([parents](uint begin, uint end) {
+        for (uint i = begin; i < end; ++i) {
+            parents[i] = i;
+        }
+    });
+
+    // Each bond is seen from both of its indices and taken at the smaller
+    forClusterChunks([&in, s, p, u, parents](uint begin, uint end) {
+        for (uint i = begin; i < end; ++i) {
+            for (uint32_t k = in.siteOffsets[i]; k < in.siteOffsets[i + 1];
+                 ++k) {
+                uint j = in.neighbors[k];
+                int bond = in.couplings[k] * s[i] * s[j];
+
+                if (j > i && bond > 0 && p[bond] > u[k]) {
+                    uniteClusters(parents, i, j);
+                }
+            }
+        }
+    });
+
+    forClusterChunks([s, coins, parents](uint begin, uint end) mutable {
+        for (uint i = begin; i < end; ++i) {
+            uint root = findCluster(parents, i);
+
+            if ((coins[root >> 6] >> (root & 63)) & 1) {
+                s.flip(i);
+            }
+        }
+    });
+
+    std::atomic<int> energy(0);
+    std::atomic<int> sum(0);
+    forClusterChunks([&in, s, &energy, &sum](uint begin, uint end) {
+        int chunkEnergy = 0;
+        int chunkSum = 0;
+
+        for (uint i = begin; i < end; ++i) {
+            chunkSum += s[i];
+
+            for (uint32_t k = in.siteOffsets[i]; k < in.siteOffsets[i + 1];
+                 ++k) {
+                uint j = in.neighbors[k];
+                chunkEnergy -= (j > i) * in.couplings[k] * s[i] * s[j];
+            }
+        }
+
+        energy += chunkEnergy;
+        sum += chunkSum;
+    });
+
+    totalEnergy = energy;
+    spinSum = sum;
+
+    if (useFields) {
+        initFields();
+    }
+
+    if (useSigns) {
+        initSigns();
+    }
+}
+
+// Creutz demon sweeps. Each block of DEMON_BLOCK consecutive indices shares a
+// demon holding a non-negative integer energy, and a flip is accepted when
+// the demon can pay for it, with no random number or exponential involved.
+// Each such step conserves the energy of the spins and demon together and
+// undoes itself when repeated, so it keeps exp(-(E + demon) / T) invariant.
+// Demons are redrawn from that distribution, a geometric one, at the start
+// of every sweep, which keeps the replica at its temperature with one
+// uniform per block. The energies the demons end sweeps with follow the
+// same distribution once the replica is in equilibrium, so their mean
+// measures the temperature the spins are at.
+template <class V>
+void Replica::updateDemon(V s) {
+    const uint n = prop.numIndices;
+    demons.resize((n + DEMON_BLOCK - 1) / DEMON_BLOCK);
+
+    for (auto& demon : demons) {
+        demon = (int)(-temperature * std::log(1 - gen.randFloatCO()));
+    }
+
+    for (uint b = 0; b < demons.size(); ++b) {
+        int demon = demons[b];
+        uint end = std::min(n, (b + 1) * DEMON_BLOCK);
+
+        for (uint i = b * DEMON_BLOCK; i < end; ++i) {
+            int energy = findIndexEnergy(s, i);
+
+            // The flip changes the total energy by -2 * energy
+            if (-2 * energy <= demon) {
+                demon += 2 * energy;
+                flip(s, i, energy);
+            }
+        }
+
+        demons[b] = demon;
+        demonEnergySum += demon;
+    }
+
+    demonSamples += demons.size();
+}
+
+// Inverts the mean of a geometric distribution over integer energies,
+// 1 / (exp(1 / T) - 1). Statistics restart when the temperature changes.
+double Replica::getDemonTemperature() const {
+    if (demonSamples == 0 || demonEnergySum == 0) {
+        return 0;
+    }
+
+    return 1 / std::log(1 + demonSamples / demonEnergySum);
+}
+
+// Rejection-free continuous-time Metropolis (the n-fold way). Each index
+// tries to flip at rate 1 per sweep and succeeds at rate min(1, exp(2e / T))
+// for index energy e, so indices are bucketed by energy into classes whose
+// rates sit in the leaves of a sum tree. Each event draws the waiting time
+// from the total rate, then a class from the tree and an index from the
+// class. An update runs the chain for one sweep of time; the last waiting
+// time is memoryless, so it is dropped rather than carried over.
+//
+// Index energies come from the incremental local fields, which are turned on
+// for the replica the first time it is needed. Classes are rebuilt at the
+// start of each update, as swaps and cluster moves change spins and
+// temperatures in between, and only the flipped index and those sharing a
+// term with it are reclassified after each event.
+template <class V>
+void Replica::updateNFold(V s) {
+    const CompiledInteractions& in = prop.interactions;
+
+    if (!useFields) {
+        setLocalFields(true);
+    }
+
+    initFlipClasses(s);
+
+    double time = 0;
+    while (true) {
+        double total = classRates[1];
+        time -= std::log(1 - gen.randFloatCO()) / total;
+
+        if (time > 1) {
+            break;
+        }
+
+        // Descend to a class, never into a side whose rate is zero
+        double x = gen.randFloatCO() * total;
+        uint n = 1;
+        while (n < classLeaves) {
+            n *= 2;
+
+            if (x >= classRates[n] && classRates[n + 1] > 0) {
+                x -= classRates[n];
+                ++n;
+            }
+        }
+
+        const ivector& sites = classSites[n - classLeaves];
+        int index = sites[gen.randInt() % sites.size()];
+        flip(s, index, (int)(n - classLeaves) - prop.maxIndexEnergy);
+        reclassify(s, index);
+
+        for (uint32_t k = in.siteOffsets[index]; k < in.siteOffsets[index + 1];
+             ++k) {
+            if (in.pairwise) {
+                reclassify(s, in.neighbors[k]);
+                continue;
+            }
+
+            for (uint32_t m = in.termOffsets[k]; m < in.termOffsets[k + 1];
+                 ++m) {
+                reclassify(s, in.neighbors[m]);
+            }
+        }
+    }
+}
+
+// Class c holds the indices of energy c - maxIndexEnergy. The tree keeps
+// its leaves at [classLeaves, 2 * classLeaves) and each parent the sum of
+// its children, so rates are rewritten rather than accumulated and do not
+// drift.
+template <class V>
+void Replica::initFlipClasses(V s) {
+    uint numClasses = 2 * prop.maxIndexEnergy + 1;
+
+    classSites.resize(numClasses);
+    for (auto& sites : classSites) {
+        sites.clear();
+    }
+
+    classLeaves = 1;
+    while (classLeaves < numClasses) {
+        classLeaves *= 2;
+    }
+
+    classRates.assign(2 * classLeaves, 0);
+    siteClasses.resize(prop.numIndices);
+    sitePositions.resize(prop.numIndices);
+
+    for (uint i = 0; i < prop.numIndices; ++i) {
+        int c = findIndexEnergy(s, i) + prop.maxIndexEnergy;
+        siteClasses[i] = c;
+        sitePositions[i] = classSites[c].size();
+        classSites[c].push_back(i);
+    }
+
+    for (uint c = 0; c < numClasses; ++c) {
+        classRates[classLeaves + c] =
+            classSites[c].size() * findFlipRate(c - prop.maxIndexEnergy);
+    }
+
+    for (uint n = classLeaves - 1; n > 0; --n) {
+        classRates[n] = classRates[2 * n] + classRates[2 * n + 1];
+    }
+}
+
+template <class V>
+void Replica::reclassify(V s, int index) {
+    int c = findIndexEnergy(s, index) + prop.maxIndexEnergy;
+    int old = siteClasses[index];
+
+    if (c == old) {
+        return;
+    }
+
+    // Move the last index of the old class into the vacated position
+    ivector& oldSites = classSites[old];
+    int last = oldSites.back();
+    oldSites[sitePositions[index]] = last;
+    sitePositions[last] = sitePositions[index];
+    oldSites.pop_back();
+
+    siteClasses[index] = c;
+    sitePositions[index] = classSites[c].size();
+    classSites[c].push_back(index);
+
+    updateClassRate(old);
+    updateClassRate(c);
+}
+
+void Replica::updateClassRate(int c) {
+    uint n = classLeaves + c;
+    classRates[n] =
+        classSites[c].size() * findFlipRate(c - prop.maxIndexEnergy);
+
+    for (n /= 2; n > 0; n /= 2) {
+        classRates[n] = classRates[2 * n] + classRates[2 * n + 1];
+    }
+}
+
+template <class J, class V>
+void Replica::findColorAcceptances(V s, const ivector& colorClass, uint begin,
+                                   uint end) {
+    auto& energies = colorEnergiesOf<J>();
+
+    for (uint n = begin; n < end; ++n) {
+        energies[n] = findIndexEnergy<J>(s, colorClass[n]);
+    }
+
+    if constexpr (std::is_integral<J>::value) {
+        const double* p = probabilities.data();
+        for (uint n = begin; n < end; ++n) {
+            int e = energies[n];
+            colorAccepted[n] =
+                (e >= 0) | (p[e < 0 ? -e : 0] > colorUniforms[n]);
+        }
     } else {
-        return 1;
+        for (uint n = begin; n < end; ++n) {
+            colorAccepted[n] = energies[n] >= colorUniforms[n];
+        }
     }
 }
 
-int Replica::findTotalEnergy() {
-    int energy = 0;
+// Real couplings draw a uniform for every step of a sweep up front and turn
+// them all into energy thresholds, as the dense engine does: a flip of index
+// energy e is accepted when e >= T / 2 * log(1 - u), with probability
+// exp(2e / T). The logarithms vectorize. Integer couplings draw nothing here
+// and look their flips up in the table instead.
+template <class J>
+void Replica::drawThresholds() {
+    if (std::is_integral<J>::value) {
+        return;
+    }
+
+    thresholds.resize(prop.numIndices);
+    gen.fillFloatCO(thresholds.data(), prop.numIndices);
+    getKernels().findThresholds(thresholds.data(), temperature / 2,
+                                prop.numIndices);
+}
+
+// Flips that do not raise the energy are accepted without drawing a uniform
+bool Replica::acceptFlip(int indexEnergy) {
+    if (indexEnergy >= 0) {
+        return true;
+    }
+
+    return probabilities[-indexEnergy] > gen.randFloatCO();
+}
+
+// Step i of a sweep: integer couplings use the table, real ones the
+// threshold drawn for the step
+bool Replica::acceptFlip(int indexEnergy, uint) {
+    return acceptFlip(indexEnergy);
+}
+
+bool Replica::acceptFlip(float indexEnergy, uint step) {
+    return indexEnergy >= thresholds[step];
+}
+
+// Flipping an index negates every term containing it, so the total energy
+// changes by twice the negated index energy.
+template <class J, class V>
+void Replica::flip(V s, int index, Field<J> indexEnergy) {
+    s.flip(index);
+    spinSum += 2 * s[index];
+    energyOf<J>() -= 2 * (Energy<J>)indexEnergy;
+
+    if (useFields) {
+        updateFields<J>(s, index);
+    }
+
+    if (useSigns) {
+        const CompiledInteractions& in = prop.interactions;
+
+        for (uint32_t k = in.siteOffsets[index]; k < in.siteOffsets[index + 1];
+             ++k) {
+            signs[in.termIds[k]] = -signs[in.termIds[k]];
+        }
+    }
+}
+
+// Each term is counted once, at the lowest index it contains
+template <class J, class V>
+Replica::Energy<J> Replica::findTotalEnergy(V s) {
+    const CompiledInteractions& in = prop.interactions;
+    const J* couplings = couplingsOf<J>();
+    Energy<J> energy = 0;
 
     for (uint i = 0; i < prop.numIndices; ++i) {
-        energy += findIndexEnergy(i);
+        for (uint32_t k = in.siteOffsets[i]; k < in.siteOffsets[i + 1]; ++k) {
+            Energy<J> couplingEnergy = (Energy<J>)couplings[k] * s[i];
+            bool isLowest = true;
+
+            for (uint32_t n = in.termOffsets[k]; n < in.termOffsets[k + 1];
+                 ++n) {
+                couplingEnergy *= s[in.neighbors[n]];
+                isLowest = isLowest && in.neighbors[n] > i;
+            }
+
+            if (isLowest) {
+                energy -= couplingEnergy;
+            }
+        }
     }
 
     return energy;
 }
 
-int Replica::findIndexEnergy(int index) {
+// The energy of an index is the sum of its terms, whose signs are cached
+int Replica::findSignEnergy(int index) {
+    const CompiledInteractions& in = prop.interactions;
     int energy = 0;
 
-    ivector2::const_iterator it1;
-    ivector::const_iterator it2;
+    for (uint32_t k = in.siteOffsets[index]; k < in.siteOffsets[index + 1];
+         ++k) {
+        energy -= in.couplings[k] * signs[in.termIds[k]];
+    }
+
+    return energy;
+}
+
+// Float fields drift from the ones recomputed, so only integer ones are
+// checked against them
+template <class J, class V>
+Replica::Field<J> Replica::findIndexEnergy(V s, int index) {
+    if constexpr (std::is_integral<J>::value) {
+        if (useSigns) {
+#ifdef ISING_DEBUG
+            assert(findSignEnergy(index) ==
+                       -s[index] * findIndexField(s, index) &&
+                   "Term sign cache out of date!\n");
+#endif
+            return findSignEnergy(index);
+        }
 
-    auto end = prop.indInteractions[index].end();
-    for (it1 = prop.indInteractions[index].begin(); it1 != end; ++it1) {
-        it2 = it1->begin();
-        int couplingEnergy = *it2;
+#ifdef ISING_DEBUG
+        assert((!useFields || fields[index] == findIndexField(s, index)) &&
+               "Local field cache out of date!\n");
+#endif
+    }
 
-        for (++it2; it2 != it1->end(); ++it2) {
-            couplingEnergy *= spins[*it2];
+    if (useFields) {
+        return -s[index] * fieldsOf<J>()[index];
+    }
+
+    // Pairwise terms take their products straight from the view, which
+    // packed spins answer from the parity of two bits
+    const CompiledInteractions& in = prop.interactions;
+    const J* couplings = couplingsOf<J>();
+    if (in.pairwise) {
+        Field<J> energy = 0;
+
+        for (uint32_t k = in.siteOffsets[index]; k < in.siteOffsets[index + 1];
+             ++k) {
+            energy -= couplings[k] * s.product(index, in.neighbors[k]);
         }
 
-        energy -= couplingEnergy;
+        return energy;
     }
 
-    return spins[index] * energy;
+    return -s[index] * findIndexField<J>(s, index);
 }
 
-double Replica::findMagnetization() {
-    double magnetism = 0;
+template <class J, class V>
+Replica::Field<J> Replica::findIndexField(V s, int index) {
+    const CompiledInteractions& in = prop.interactions;
+    const J* couplings = couplingsOf<J>();
+    Field<J> field = 0;
 
-    for (uint i = 0; i < prop.numIndices; ++i) {
-        magnetism += spins[i];
+    uint32_t end = in.siteOffsets[index + 1];
+    if (in.pairwise) {
+        for (uint32_t k = in.siteOffsets[index]; k < end; ++k) {
+            field += couplings[k] * s[in.neighbors[k]];
+        }
+    } else {
+        for (uint32_t k = in.siteOffsets[index]; k < end; ++k) {
+            Field<J> couplingEnergy = couplings[k];
+
+            for (uint32_t n = in.termOffsets[k]; n < in.termOffsets[k + 1];
+                 ++n) {
+                couplingEnergy *= s[in.neighbors[n]];
+            }
+
+            field += couplingEnergy;
+        }
     }
 
-    return magnetism / prop.numIndices;
+    return field;
+}
+
+void Replica::flipSpin(int index) {
+    withKernels([this, index](auto s, auto j) {
+        typedef decltype(j) J;
+        flip<J>(s, index, findIndexEnergy<J>(s, index));
+    });
+}
+
+// Flipping index changes the total energy by -2 times this
+int Replica::getIndexEnergy(int index) {
+    return withSpins(
+        [this, index](auto s) { return findIndexEnergy(s, index); });
 }
 
 void Replica::flipSpins() {
-    for (auto& s : spins) {
-        s *= -1;
+    if (usePacked) {
+        packed.flipAll();
+    } else {
+        for (auto& s : spins) {
+            s *= -1;
+        }
+    }
+
+    spinSum *= -1;
+
+    // Pairwise terms are invariant under a global flip; k-body terms of odd
+    // order are not, so those Hamiltonians are recounted.
+    if (prop.interactions.pairwise) {
+        for (auto& f : fields) {
+            f *= -1;
+        }
+
+        for (auto& f : realFields) {
+            f *= -1;
+        }
+    } else {
+        if (useFields) {
+            initFields();
+        }
+
+        if (useSigns) {
+            initSigns();
+        }
+
+        withKernels([this](auto s, auto j) {
+            typedef decltype(j) J;
+            energyOf<J>() = findTotalEnergy<J>(s);
+        });
     }
 }
 
+// Prints spins by original label, whatever order the indices are kept in
 void Replica::print() const {
     uint side = prop.cols;
     if (prop.cols == -1) {
@@ -141,7 +1215,8 @@ void Replica::print() const {
 
     for (uint i = 0; i < prop.numIndices;) {
         for (uint col = 0; col < side && i < prop.numIndices; ++col, ++i) {
-            (spins.at(i) == 1) ? std::cout << "+ " : std::cout << "- ";
+            int spin = getSpin(prop.labelPositions[i]);
+            (spin == 1) ? std::cout << "+ " : std::cout << "- ";
         }
 
         std::cout << "\n";
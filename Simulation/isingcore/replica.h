@@ -3,44 +3,205 @@
 
 #include <cmath>
 #include "common.h"
+#include "packedspins.h"
 #include "properties.h"
 
 namespace ising {
+const uint COLOR_CHUNK = 4096;
+// Fewest indices given to each thread of a Swendsen-Wang pass
+const uint CLUSTER_CHUNK = 4096;
+// Consecutive indices sharing one demon in DEMON mode
+const uint DEMON_BLOCK = 64;
+// Sweeps between recomputing the float fields and double energy of real
+// couplings, which bounds the rounding drift of the incremental updates
+const uint REAL_REFRESH_SWEEPS = 64;
+
+// The sweep kernels are compiled once for each coupling type J. Integer
+// couplings, narrowed to int16_t, keep exact int fields and energies; real
+// couplings, held in float, accumulate fields in float, with total energies
+// kept in double.
+template <class J>
+struct ReplicaTypes {
+    typedef int Field;
+    typedef int Energy;
+};
+
+template <>
+struct ReplicaTypes<float> {
+    typedef float Field;
+    typedef double Energy;
+};
+
 class Replica {
    public:
     Replica(const LatticeProperties& properties, uint n);
     ~Replica() {}
 
-    cvector getSpins() const { return spins; }
+    cvector getSpins() const { return usePacked ? packed.unpack() : spins; }
+    PackedSpins getPackedSpins() const {
+        return usePacked ? packed : PackedSpins(spins);
+    }
+    int getSpin(uint i) const { return usePacked ? packed.get(i) : spins[i]; }
     const LatticeProperties& getProperties() const { return prop; }
     uint getReplicaIndex() { return replicaIndex; }
     double getTemperature() { return temperature; }
     void setTemperature(double t);
-    int getTotalEnergy() { return findTotalEnergy(); }
-    double getMagnetization() { return findMagnetization(); }
+    // Skips the range check of setTemperature, for population annealing and
+    // domain walls, which warm replicas up above the lattice's temperatures
+    void setTemperatureUnchecked(double t);
+    // Integer couplings only; getEnergy holds the energy of either kind
+    int getTotalEnergy() const { return totalEnergy; }
+    double getEnergy() const { return useReal ? realEnergy : totalEnergy; }
+    bool hasRealCouplings() const { return useReal; }
+    int getSpinSum() const { return spinSum; }
+    int getSpinSum(const wvector& mask, uint maskSize) const;
+    uint countDifferences(const Replica& other) const;
+    double getMagnetization() const {
+        return (double)spinSum / prop.numIndices;
+    }
+    double getDemonTemperature() const;
+
+    bool hasLocalFields() const { return useFields; }
+    void setLocalFields(bool enable);
+    bool hasTermSigns() const { return useSigns; }
+    void setTermSigns(bool enable);
+    bool hasPackedSpins() const { return usePacked; }
+    void setPackedSpins(bool enable);
 
     void update();
+    // Exits unless replicas of the mode update on their own, as engines that
+    // move replicas between temperatures one by one need
+    static void checkReplicaMode(char mode, const std::string& engine);
     void reinit() { initSpins(); }
+    void seed(uint64_t runSeed, uint64_t stream);
+    // Moves to another random stream but keeps the spins
+    void reseed(uint64_t runSeed, uint64_t stream) {
+        gen.setStream(runSeed, stream);
+    }
+    void loadSpins(const char* s, uint stride, int energy, int sum);
     void flipSpins();
-    void flipSpin(int index) { spins[index] *= -1; }
+    void flipSpin(int index);
+    // Integer couplings only
+    int getIndexEnergy(int index);
     void print() const;
 
    private:
-    void updateAll();
-    void updatePseudo();
-    void updateRandom();
-    double findProbability(int index);
-    int findTotalEnergy();
-    inline int findIndexEnergy(int index);
-    double findMagnetization();
+    template <class J>
+    using Field = typename ReplicaTypes<J>::Field;
+    template <class J>
+    using Energy = typename ReplicaTypes<J>::Energy;
+
+    template <class F>
+    auto withSpins(F f);
+    template <class F>
+    void withKernels(F f);
+    template <class J>
+    const J* couplingsOf() const;
+    template <class J>
+    std::vector<Field<J>>& fieldsOf();
+    template <class J>
+    Energy<J>& energyOf();
+    template <class J>
+    std::vector<Field<J>>& colorEnergiesOf();
+
+    template <class V>
+    void update(V s);
+    template <class V>
+    void updateReal(V s);
+    template <class J = int16_t, class V>
+    void updateAll(V s);
+    template <int S, class V>
+    void updateStencil(V s);
+    template <class J = int16_t, class V>
+    void updatePseudo(V s);
+    template <class J = int16_t, class V>
+    void updateRandom(V s);
+    template <class J = int16_t, class V>
+    void updateColored(V s);
+    template <class V>
+    void updateWolff(V s);
+    template <class V>
+    void updateSwendsenWang(V s);
+    template <class F>
+    void forClusterChunks(F f);
+    template <class V>
+    void updateDemon(V s);
+    template <class V>
+    void updateNFold(V s);
+    template <class V>
+    void initFlipClasses(V s);
+    template <class V>
+    void reclassify(V s, int index);
+    void updateClassRate(int c);
+    double findFlipRate(int indexEnergy) const {
+        return indexEnergy >= 0 ? 1 : probabilities[-indexEnergy];
+    }
+    template <class J = int16_t, class V>
+    void findColorAcceptances(V s, const ivector& colorClass, uint begin,
+                              uint end);
+    void generateProbabilities();
+    template <class J>
+    void drawThresholds();
+    inline bool acceptFlip(int indexEnergy);
+    inline bool acceptFlip(int indexEnergy, uint step);
+    inline bool acceptFlip(float indexEnergy, uint step);
+    template <class J = int16_t, class V>
+    inline void flip(V s, int index, Field<J> indexEnergy);
+    template <class J = int16_t, class V>
+    Energy<J> findTotalEnergy(V s);
+    template <class J = int16_t, class V>
+    inline Field<J> findIndexEnergy(V s, int index);
+    template <class J = int16_t, class V>
+    inline Field<J> findIndexField(V s, int index);
 
     void initSpins();
+    void initFields();
+    void initSigns();
+    void initTotals();
+    inline int findSignEnergy(int index);
+    template <class J = int16_t, class V>
+    void updateFields(V s, int index);
 
     cvector spins;
+    PackedSpins packed;
+    bool usePacked;
     const LatticeProperties& prop;
     uint replicaIndex;
     double temperature;
+    dvector probabilities;
+    dvector bondProbabilities;
+    fvector thresholds;
+    ivector fields;
+    fvector realFields;
+    bool useFields;
+    cvector signs;
+    bool useSigns;
+    bool useReal;
+    int totalEnergy;
+    double realEnergy;
+    uint realSweeps;
+    int spinSum;
     ivector randomizedIndices;
+    ivector colorEnergies;
+    fvector realColorEnergies;
+    fvector colorUniforms;
+    cvector colorAccepted;
+    ivector clusterStack;
+    std::vector<uint32_t> visitStamps;
+    uint32_t stamp;
+    std::vector<uint64_t> wolffClusters;
+    std::vector<uint64_t> wolffFlips;
+    fvector bondUniforms;
+    wvector clusterCoins;
+    std::vector<uint32_t> clusterParents;
+    ivector2 classSites;
+    ivector siteClasses;
+    ivector sitePositions;
+    dvector classRates;
+    uint classLeaves;
+    ivector demons;
+    double demonEnergySum;
+    uint64_t demonSamples;
     RandomGenerator gen;
 };
 }
@@ -0,0 +1,199 @@
+#include "replicaarena.h"
+
+using namespace ising;
+
+ReplicaArena::ReplicaArena(const LatticeProperties& properties, uint n)
+    : prop(properties), replicas(n), width(prop.numT * n) {
+    spins.resize(prop.numIndices * width);
+    totalEnergies.resize(width);
+    spinSums.resize(width);
+    fields.resize(width);
+    terms.resize(width);
+    energies.resize(width);
+
+    for (uint t = 0; t < prop.numT; ++t) {
+        temperatures.push_back(prop.minT + t * prop.dT);
+    }
+
+    generateProbabilities();
+    resetSlots();
+}
+
+void ReplicaArena::generateProbabilities() {
+    probabilities.assign(prop.numT, dvector(prop.maxIndexEnergy + 1));
+
+    for (uint t = 0; t < prop.numT; ++t) {
+        for (int e = 0; e <= prop.maxIndexEnergy; ++e) {
+            probabilities[t][e] = pow(E, (-1 / temperatures[t]) * (2 * e));
+        }
+    }
+
+}
+
+// Puts every configuration back in its own slot
+void ReplicaArena::resetSlots() {
+    slots.resize(width);
+    slotProbabilities.resize(width);
+
+    for (uint s = 0; s < width; ++s) {
+        slots[s] = s;
+        slotProbabilities[s] = probabilities[s / replicas].data();
+    }
+}
+
+// A new stream starts from the identity permutation of slots, so that what
+// earlier swaps did does not carry over into the next trial
+void ReplicaArena::seed(uint64_t runSeed, uint64_t stream) {
+    gen.setStream(runSeed, stream);
+    resetSlots();
+}
+
+void ReplicaArena::load(uint t, uint r, const Replica& replica) {
+    uint slot = getSlot(t, r);
+
+    for (uint i = 0; i < prop.numIndices; ++i) {
+        spins[i * width + slot] = (char)replica.getSpin(i);
+    }
+
+    totalEnergies[slot] = replica.getTotalEnergy();
+    spinSums[slot] = replica.getSpinSum();
+}
+
+void ReplicaArena::store(uint t, uint r, Replica& replica) const {
+    uint slot = getSlot(t, r);
+    replica.loadSpins(spins.data() + slot, width, totalEnergies[slot],
+                      spinSums[slot]);
+}
+
+uint ReplicaArena::countDifferences(uint t, uint r0, uint r1) const {
+    uint a = getSlot(t, r0);
+    uint b = getSlot(t, r1);
+    uint count = 0;
+
+    for (uint i = 0; i < prop.numIndices; ++i) {
+        count += spins[i * width + a] != spins[i * width + b];
+    }
+
+    return count;
+}
+
+// Flips index i of the configuration at (t, r), whose energy changes by -2
+// times the index energy as in a sweep
+void ReplicaArena::flipSpin(uint t, uint r, uint i) {
+    const CompiledInteractions& in = prop.interactions;
+    const char* s = spins.data() + getSlot(t, r);
+    const uint w = width;
+    int field = 0;
+
+    for (uint32_t k = in.siteOffsets[i]; k < in.siteOffsets[i + 1]; ++k) {
+        if (in.pairwise) {
+            field += in.couplings[k] * s[in.neighbors[k] * w];
+        } else {
+            int term = in.couplings[k];
+            for (uint32_t n = in.termOffsets[k]; n < in.termOffsets[k + 1];
+                 ++n) {
+                term *= s[in.neighbors[n] * w];
+            }
+            field += term;
+        }
+    }
+
+    uint slot = getSlot(t, r);
+    char& spin = spins[i * w + slot];
+    int e = -spin * field;
+
+    spin = -spin;
+    totalEnergies[slot] -= 2 * e;
+    spinSums[slot] += 2 * spin;
+}
+
+// Pairwise terms are invariant under a global flip; other Hamiltonians are
+// flipped index by index so that the energy follows.
+void ReplicaArena::flipSpins(uint t, uint r) {
+    if (!prop.interactions.pairwise) {
+        for (uint i = 0; i < prop.numIndices; ++i) {
+            flipSpin(t, r, i);
+        }
+        return;
+    }
+
+    uint slot = getSlot(t, r);
+    for (uint i = 0; i < prop.numIndices; ++i) {
+        spins[i * width + slot] *= -1;
+    }
+    spinSums[slot] *= -1;
+}
+
+// Local field of index in every slot. The kernels run over slots with unit
+// stride, so each coupling is applied to all of them as one vector.
+void ReplicaArena::findFields(uint index) {
+    const CompiledInteractions& in = prop.interactions;
+    const Kernels& kernels = getKernels();
+    const uint w = width;
+    int* field = fields.data();
+    int* term = terms.data();
+
+    std::fill(fields.begin(), fields.end(), 0);
+
+    uint32_t end = in.siteOffsets[index + 1];
+    if (in.pairwise) {
+        for (uint32_t k = in.siteOffsets[index]; k < end; ++k) {
+            const char* s = spins.data() + in.neighbors[k] * w;
+            kernels.addScaledChars(field, s, in.couplings[k], w);
+        }
+    } else {
+        for (uint32_t k = in.siteOffsets[index]; k < end; ++k) {
+            std::fill(terms.begin(), terms.end(), in.couplings[k]);
+
+            for (uint32_t n = in.termOffsets[k]; n < in.termOffsets[k + 1];
+                 ++n) {
+                kernels.multiplyChars(term, spins.data() + in.neighbors[n] * w,
+                                      w);
+            }
+
+            kernels.addInts(field, term, w);
+        }
+    }
+}
+
+// Uniforms are only drawn for uphill flips, in slot order
+void ReplicaArena::monteCarloSweep() {
+    const uint w = width;
+    const int* field = fields.data();
+    int* energy = energies.data();
+    const double* const* p = slotProbabilities.data();
+
+    for (uint i = 0; i < prop.numIndices; ++i) {
+        findFields(i);
+
+        char* s = spins.data() + i * w;
+        getKernels().findEnergies(energy, s, field, w);
+
+        for (uint x = 0; x < w; ++x) {
+            int e = energy[x];
+            if (e >= 0 || p[x][-e] > gen.randFloatCO()) {
+                s[x] = -s[x];
+                totalEnergies[x] -= 2 * e;
+                spinSums[x] += 2 * s[x];
+            }
+        }
+    }
+}
+
+void ReplicaArena::parallelTemperingUpdate() {
+    for (uint t = 0; t < prop.numT - 1; ++t) {
+        for (uint r = 0; r < replicas; ++r) {
+            int& a = slots[t * replicas + r];
+            int& b = slots[(t + 1) * replicas + r];
+            double dEnergy = totalEnergies[a] - totalEnergies[b];
+            double dBoltzmann = 1 / temperatures[t] - 1 / temperatures[t + 1];
+            double exponent = dEnergy * dBoltzmann;
+
+            if (exponent >= 0 || pow(E, exponent) > gen.randFloatCO()) {
+                std::swap(a, b);
+                slotProbabilities[a] = probabilities[t].data();
+                slotProbabilities[b] = probabilities[t + 1].data();
+            }
+        }
+    }
+}
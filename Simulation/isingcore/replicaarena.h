@@ -0,0 +1,62 @@
+#ifndef REPLICAARENA_H_
+#define REPLICAARENA_H_
+
+#include "kernels.h"
+#include "replica.h"
+
+namespace ising {
+// Structure-of-arrays store of every replica of a lattice: spins[i * width +
+// s] holds index i of slot s, so a sweep visits each index once and updates
+// it in all slots together, loading its couplings a single time. Slot s
+// holds the configuration of replica slots[t * REPLICAS + r] at temperature
+// slot t; parallel tempering swaps permute slots instead of moving spins.
+// Indices are visited in order, as in ALL mode.
+class ReplicaArena {
+   public:
+    ReplicaArena(const LatticeProperties& properties, uint replicas);
+
+    uint getWidth() const { return width; }
+    uint getSlot(uint t, uint r) const { return slots[t * replicas + r]; }
+    int getTotalEnergy(uint t, uint r) const {
+        return totalEnergies[getSlot(t, r)];
+    }
+    int getSpinSum(uint t, uint r) const { return spinSums[getSlot(t, r)]; }
+    int getSpin(uint t, uint r, uint i) const {
+        return spins[i * width + getSlot(t, r)];
+    }
+    uint countDifferences(uint t, uint r0, uint r1) const;
+
+    void seed(uint64_t runSeed, uint64_t stream);
+    void load(uint t, uint r, const Replica& replica);
+    void store(uint t, uint r, Replica& replica) const;
+    void flipSpin(uint t, uint r, uint i);
+    void flipSpins(uint t, uint r);
+
+    void monteCarloSweep();
+    void parallelTemperingUpdate();
+
+   private:
+    void generateProbabilities();
+    void resetSlots();
+    void findFields(uint index);
+
+    const LatticeProperties& prop;
+    uint replicas;
+    uint width;
+
+    cvector spins;
+    ivector slots;
+    ivector totalEnergies;
+    ivector spinSums;
+
+    dvector temperatures;
+    dvector2 probabilities;
+    std::vector<const double*> slotProbabilities;
+    ivector fields;
+    ivector terms;
+    ivector energies;
+    RandomGenerator gen;
+};
+}
+
+#endif /* REPLICAARENA_H_ */
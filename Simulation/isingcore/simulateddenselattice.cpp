@@ -0,0 +1,225 @@
+#include "simulateddenselattice.h"
+
+using namespace ising;
+
+template <class J>
+SimulatedDenseLattice<J>::SimulatedDenseLattice(
+    const DenseCouplings &couplings, double t, double dt, uint n,
+    const std::string &filename, uint trial, uint updates, uint preupdates)
+    : lattice(couplings, t, dt, n, 1),
+      trial(trial),
+      updates(updates),
+      preupdates(preupdates) {
+    lattice.seed(trial);
+    initTempFile(filename);
+
+    for (uint i = 0; i < lattice.getNumTemperatures(); ++i) {
+        temperatures[i] = lattice.getTemperature(i);
+    }
+}
+
+// The temp directory is made by Simulation before any trial starts
+template <class J>
+void SimulatedDenseLattice<J>::initTempFile(const std::string &filename) {
+    fs::path tempDirectory = fs::path(filename);
+    std::ostringstream latticeName;
+    latticeName << trial << tempDirectory.filename().string();
+
+    tempDirectory.remove_filename();
+    tempDirectory.replace_filename("temp/");
+    tempFile = tempDirectory / latticeName.str();
+
+    std::ofstream file(tempFile);
+    file << "temperature,avg_mag,avg_mag2,avg_mag4,chi0_re,chi0_im,chiq_re,"
+         << "chiq_im\n";
+    file.close();
+}
+
+template <class J>
+void SimulatedDenseLattice<J>::updateTempFile() {
+    std::ofstream file(tempFile, std::ofstream::out | std::ofstream::app);
+
+    for (auto &t : temperatures) {
+        uint i = t.first;
+        std::ostringstream row;
+        row << t.second << "," << avgMag[i] << "," << avgMag2[i] << ","
+            << avgMag4[i] << "," << chi0[i].real() << "," << chi0[i].imag()
+            << "," << chiq[i].real() << "," << chiq[i].imag() << "\n";
+        file << row.str();
+    }
+
+    file.close();
+}
+
+template <class J>
+void SimulatedDenseLattice<J>::runLatticeSimulation() {
+    runPreupdates();
+
+    if (updates == 0) {
+        uint powerMax = 8;
+        uint power = std::min(reachStability(), powerMax);
+        runUpdates(BASEUPDATES * static_cast<uint>(std::pow(2, power)));
+    } else {
+        runUpdates(updates);
+    }
+
+    updateTempFile();
+}
+
+template <class J>
+void SimulatedDenseLattice<J>::runPreupdates() {
+    for (uint i = 0; i < preupdates; ++i) {
+        lattice.update();
+    }
+}
+
+template <class J>
+void SimulatedDenseLattice<J>::runUpdates(uint cycleUpdates) {
+    uint numT = lattice.getNumTemperatures();
+
+    runningMag.assign(numT, 0);
+    runningMag2.assign(numT, 0);
+    runningMag4.assign(numT, 0);
+    runningCorrK0.assign(numT, 0);
+
+    for (uint num1 = 0; num1 < cycleUpdates; ++num1) {
+        for (uint num2 = 0; num2 < SKIP; ++num2) {
+            lattice.update();
+        }
+
+        measure();
+    }
+
+    recordResults(cycleUpdates);
+}
+
+template <class J>
+void SimulatedDenseLattice<J>::measure() {
+    uint numIndices = lattice.getNumIndices();
+
+    for (uint t = 0; t < lattice.getNumTemperatures(); ++t) {
+        double total = lattice.getSpinSum(t, 0);
+        double m = total / numIndices;
+
+        runningMag[t] += m;
+        runningMag2[t] += pow(m, 2);
+        runningMag4[t] += pow(m, 4);
+        runningCorrK0[t] += total * total;
+    }
+}
+
+template <class J>
+void SimulatedDenseLattice<J>::recordResults(uint cycleUpdates) {
+    uint numIndices = lattice.getNumIndices();
+
+    for (auto &t : temperatures) {
+        uint i = t.first;
+        double mag = fabs(runningMag[i]) / cycleUpdates;
+        double mag2 = fabs(runningMag2[i]) / cycleUpdates;
+        double mag4 = fabs(runningMag4[i]) / cycleUpdates;
+
+        if (mag > 1 || mag2 > 1 || mag4 > 1) {
+            std::cout << "\nInvalid average magnetization!";
+            std::cout << "Must be between 0.0 and 1.0\n\n";
+            exit(EXIT_FAILURE);
+        }
+
+        avgMag[i] = mag;
+        avgMag2[i] = mag2;
+        avgMag4[i] = mag4;
+        chi0[i] =
+            cdouble(runningCorrK0[i]) / cdouble(numIndices * cycleUpdates);
+        chiq[i] = chi0[i];
+    }
+}
+
+template <class J>
+uint SimulatedDenseLattice<J>::reachStability() {
+    uint numT = lattice.getNumTemperatures();
+    uint numIndices = lattice.getNumIndices();
+
+    uint cycleUpdates;
+    uint cycle;
+    dvector2 bins;
+    uint binsToCompare = 3;
+    bool continueUpdating = true;
+
+    for (cycle = 1; cycle < binsToCompare; ++cycle) {
+        cycleUpdates = BASEUPDATES * static_cast<uint>(std::pow(2, cycle));
+        dvector mags(numT);
+
+        for (uint num1 = 0; num1 < cycleUpdates; ++num1) {
+            for (uint num2 = 0; num2 < SKIP; ++num2) {
+                lattice.update();
+            }
+
+            for (uint t = 0; t < numT; ++t) {
+                mags[t] += (double)lattice.getSpinSum(t, 0) / numIndices;
+            }
+        }
+
+        for (auto &m : mags) {
+            m = fabs(m) / cycleUpdates;
+        }
+
+        bins.push_back(mags);
+    }
+
+    while (continueUpdating) {
+        cycleUpdates = BASEUPDATES * static_cast<uint>(std::pow(2, cycle));
+        dvector2 cycleMags(numT);
+
+        for (uint num1 = 0; num1 < cycleUpdates; ++num1) {
+            for (uint num2 = 0; num2 < SKIP; ++num2) {
+                lattice.update();
+            }
+
+            for (uint t = 0; t < numT; ++t) {
+                cycleMags[t].push_back((double)lattice.getSpinSum(t, 0) /
+                                       numIndices);
+            }
+        }
+
+        dvector means(numT), stds(numT);
+
+        for (uint i = 0; i < numT; ++i) {
+            means[i] =
+                std::accumulate(cycleMags[i].begin(), cycleMags[i].end(), 0.0) /
+                cycleUpdates;
+            stds[i] = std::sqrt(
+                std::accumulate(cycleMags[i].begin(), cycleMags[i].end(), 0.0,
+                                [&](double lhs, double rhs) {
+                                    return rhs + std::pow(lhs - means[i], 2);
+                                }) /
+                cycleUpdates);
+        }
+
+        continueUpdating = false;
+
+        for (uint i = 0; i < numT; ++i) {
+            if (cycle >= MAXCYCLES || continueUpdating == true) {
+                break;
+            }
+
+            for (int j = 1; j < static_cast<int>(binsToCompare); ++j) {
+                double difference =
+                    fabs((means[i] - bins.end()[-j][i]) / means[i]);
+
+                if (difference >= stds[i]) {
+                    continueUpdating = true;
+                }
+            }
+        }
+
+        if (continueUpdating) {
+            bins.push_back(means);
+            ++cycle;
+        }
+    }
+
+    return cycle;
+}
+
+template class ising::SimulatedDenseLattice<int8_t>;
+template class ising::SimulatedDenseLattice<int16_t>;
+template class ising::SimulatedDenseLattice<float>;
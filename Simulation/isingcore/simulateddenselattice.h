@@ -0,0 +1,63 @@
+#ifndef SIMULATEDDENSELATTICE_H_
+#define SIMULATEDDENSELATTICE_H_
+
+#include "denselattice.h"
+#include "simulatedlattice.h"
+
+namespace ising {
+// Runs one trial of a fully connected Hamiltonian on the dense engine and
+// records the same observables as SimulatedLattice, in the same temp file
+// layout. Dense Hamiltonians have no geometry, so every pair of indices is
+// at zero displacement and chi(q) equals chi(0).
+template <class J>
+class SimulatedDenseLattice {
+   public:
+    SimulatedDenseLattice(const DenseCouplings& couplings, double t,
+                          double dt, uint n, const std::string& filename,
+                          uint trial, uint updates,
+                          uint preupdates = PREUPDATES);
+    ~SimulatedDenseLattice() {}
+    void runLatticeSimulation();
+    const DenseLattice<J>& getLattice() const { return lattice; }
+    uint getTrial() const { return trial; }
+    uint getUpdates() const { return updates; }
+    uint getPreupdates() const { return preupdates; }
+
+    const dmap& getTemperatures() const { return temperatures; }
+    const dmap& getAvgMag() const { return avgMag; }
+    const dmap& getAvgMag2() const { return avgMag2; }
+    const dmap& getAvgMag4() const { return avgMag4; }
+    const cdmap& getChi0() const { return chi0; }
+    const cdmap& getChiq() const { return chiq; }
+
+   private:
+    DenseLattice<J> lattice;
+    uint trial;
+    uint updates;
+    uint preupdates;
+
+    dmap temperatures;
+    dmap avgMag;
+    dmap avgMag2;
+    dmap avgMag4;
+    cdmap chi0;
+    cdmap chiq;
+
+    dvector runningMag;
+    dvector runningMag2;
+    dvector runningMag4;
+    dvector runningCorrK0;
+
+    fs::path tempFile;
+
+    void initTempFile(const std::string& filename);
+    void updateTempFile();
+    void runPreupdates();
+    void runUpdates(uint cycleUpdates);
+    void measure();
+    void recordResults(uint cycleUpdates);
+    uint reachStability();
+};
+}
+
+#endif /* SIMULATEDDENSELATTICE_H_ */
@@ -20,6 +20,60 @@ SimulatedLattice::SimulatedLattice(Lattice *latt, const std::string &filename,
         temperatures[i] = getLattice()->getMinTemperature() +
                           getLattice()->getChangeTemperature() * i;
     }
+
+    findRowPhases(*lattice, q, rowGroups, rowPhases);
+    generateRowMasks();
+}
+
+// Row sums of a configuration then take one masked popcount per word
+void SimulatedLattice::generateRowMasks() {
+    uint numIndices = lattice->getNumIndices();
+    rowMasks.assign(rowPhases.size(), wvector((numIndices + 63) / 64, 0));
+    rowSizes.assign(rowPhases.size(), 0);
+
+    for (uint i = 0; i < numIndices; ++i) {
+        rowMasks[rowGroups[i]][i >> 6] |= 1ULL << (i & 63);
+        ++rowSizes[rowGroups[i]];
+    }
+}
+
+// Sum_ij s_i s_j exp(iq dx_ij) only depends on the rows of i and j, so the
+// correlation is accumulated from per-row spin sums instead of all N^2 pairs.
+// rowGroups maps each index to its row, and rowPhases[a][b] is the phase
+// between rows a and b.
+void ising::findRowPhases(Lattice &lattice, double q, ivector &rowGroups,
+                         std::vector<cdvector> &rowPhases) {
+    const LatticeProperties &prop = lattice.getProperties();
+    std::map<int, int> groups;
+    ivector representatives;
+
+    for (uint i = 0; i < prop.numIndices; ++i) {
+        int row = prop.locations[i][0];
+
+        if (groups.find(row) == groups.end()) {
+            groups[row] = (int)representatives.size();
+            representatives.push_back(i);
+        }
+
+        rowGroups.push_back(groups[row]);
+    }
+
+    rowPhases.resize(representatives.size(),
+                     cdvector(representatives.size()));
+    for (uint a = 0; a < representatives.size(); ++a) {
+        for (uint b = 0; b < representatives.size(); ++b) {
+            int dx = lattice.findXDisplacement(representatives[a],
+                                               representatives[b]);
+
+            if (prop.rows % 2 == 0 && dx == prop.rows / 2) {
+                rowPhases[a][b] = (std::exp(cdouble(0, q * dx)) +
+                                   std::exp(cdouble(0, q * -dx))) /
+                                  cdouble(2);
+            } else {
+                rowPhases[a][b] = std::exp(cdouble(0, q * dx));
+            }
+        }
+    }
 }
 
 void SimulatedLattice::initTempFile(const std::string &filename) {
@@ -56,13 +110,19 @@ void SimulatedLattice::updateTempFile() {
     }
 }
 
+// Demon sweeps only thermalize; measurements are taken with canonical
+// Metropolis sweeps
 void SimulatedLattice::runLatticeSimulation() {
     runPreupdates();
 
+    if (lattice->getMode() == DEMON) {
+        lattice->switchMode(PSEUDO);
+    }
+
     if (updates == 0) {
         runUpdatesStable();
     } else {
-        runUpdates();
+        runUpdates(updates);
     }
 
     updateTempFile();
@@ -74,139 +134,64 @@ void SimulatedLattice::runPreupdates() {
     }
 }
 
-void SimulatedLattice::runUpdates() {
-    dmap runningMag, runningMag2, runningMag4;
-    imap3 runningCorr;
+void SimulatedLattice::runUpdates(uint cycleUpdates) {
+    uint numT = lattice->getReplicaIndices().size();
+    uint numIndices = lattice->getNumIndices();
 
-    auto configs = lattice->getConfigs();
-    auto displacements = lattice->getXDisplacements();
-    auto indices = lattice->getIndices();
+    runningMag.assign(numT, 0);
+    runningMag2.assign(numT, 0);
+    runningMag4.assign(numT, 0);
+    runningCorrK0.assign(numT, 0);
+    runningCorrKq.assign(numT, 0);
+    rowSums.assign(rowPhases.size(), 0);
 
-    for (uint num1 = 0; num1 < updates; ++num1) {
+    for (uint num1 = 0; num1 < cycleUpdates; ++num1) {
         for (uint num2 = 0; num2 < SKIP; ++num2) {
             lattice->ICA();
         }
 
-        for (auto &replicas : configs) {
-            uint index = replicas[0]->getReplicaIndex();
-            double magnetization = replicas[0]->getMagnetization();
+        for (uint index = 0; index < numT; ++index) {
+            const Replica &replica = lattice->getReplica(index);
+            double magnetization = replica.getMagnetization();
             runningMag[index] += magnetization;
             runningMag2[index] += pow(magnetization, 2);
             runningMag4[index] += pow(magnetization, 4);
 
-            auto spins = replicas[0]->getSpins();
-            for (auto &i : indices) {
-                for (auto &j : indices) {
-                    runningCorr[index][i][j] += spins[i] * spins[j];
-                }
+            double total = replica.getSpinSum();
+            runningCorrK0[index] += total * total;
+
+            for (uint a = 0; a < rowSums.size(); ++a) {
+                rowSums[a] = replica.getSpinSum(rowMasks[a], rowSizes[a]);
             }
-        }
-    }
 
-    cdmap sumCorrK0, sumCorrKq;
-    for (auto &replicas : configs) {
-        for (auto &i : indices) {
-            for (auto &j : indices) {
-                uint index = replicas[0]->getReplicaIndex();
-                sumCorrK0[index] += runningCorr[index][i][j];
-
-                if (lattice->getProperties().rows % 2 == 0 &&
-                    displacements[i][j] == lattice->getProperties().rows / 2) {
-                    sumCorrKq[index] +=
-                        ((cdouble(runningCorr[index][i][j]) *
-                          std::exp(cdouble(0, q * displacements[i][j]))) +
-                         (cdouble(runningCorr[index][i][j]) *
-                          std::exp(cdouble(0, q * -displacements[i][j])))) /
-                        cdouble(2);
-                } else {
-                    sumCorrKq[index] +=
-                        cdouble(runningCorr[index][i][j]) *
-                        std::exp(cdouble(0, q * displacements[i][j]));
-                }
+            const Kernels &kernels = getKernels();
+            for (uint a = 0; a < rowSums.size(); ++a) {
+                runningCorrKq[index] +=
+                    rowSums[a] * kernels.dotPhases(rowSums.data(),
+                                                   rowPhases[a].data(),
+                                                   rowSums.size());
             }
         }
     }
 
-    auto replicaIndices = lattice->getReplicaIndices();
-    for (auto &i : replicaIndices) {
-        addAvgMag(i, fabs(runningMag[i]) / updates);
-        addAvgMag2(i, fabs(runningMag2[i]) / updates);
-        addAvgMag4(i, fabs(runningMag4[i]) / updates);
-        addChi0(i, sumCorrK0[i] / cdouble(lattice->getNumIndices() * updates));
-        addChiq(i, sumCorrKq[i] / cdouble(lattice->getNumIndices() * updates));
+    for (auto &i : lattice->getReplicaIndices()) {
+        addAvgMag(i, fabs(runningMag[i]) / cycleUpdates);
+        addAvgMag2(i, fabs(runningMag2[i]) / cycleUpdates);
+        addAvgMag4(i, fabs(runningMag4[i]) / cycleUpdates);
+        addChi0(i, cdouble(runningCorrK0[i]) /
+                       cdouble(numIndices * cycleUpdates));
+        addChiq(i, runningCorrKq[i] / cdouble(numIndices * cycleUpdates));
     }
 }
 
 void SimulatedLattice::runUpdatesStable() {
-    dmap runningMag, runningMag2, runningMag4;
-    imap3 runningCorr;
-
-    auto configs = lattice->getConfigs();
-    auto displacements = lattice->getXDisplacements();
-    auto indices = lattice->getIndices();
-
     uint powerMax = 8;
     uint power = reachStability();
     if (power > powerMax) {
         power = powerMax;
     }
-    uint cycleUpdates = BASEUPDATES * static_cast<uint>(std::pow(2, power));
-
-    for (uint num1 = 0; num1 < cycleUpdates; ++num1) {
-        for (uint num2 = 0; num2 < SKIP; ++num2) {
-            lattice->ICA();
-        }
-
-        for (auto &replicas : configs) {
-            uint index = replicas[0]->getReplicaIndex();
-            double magnetization = replicas[0]->getMagnetization();
-            runningMag[index] += magnetization;
-            runningMag2[index] += pow(magnetization, 2);
-            runningMag4[index] += pow(magnetization, 4);
-
-            auto spins = replicas[0]->getSpins();
-            for (auto &i : indices) {
-                for (auto &j : indices) {
-                    runningCorr[index][i][j] += spins[i] * spins[j];
-                }
-            }
-        }
-    }
 
-    cdmap sumCorrK0, sumCorrKq;
-    for (auto &replicas : configs) {
-        for (auto &i : indices) {
-            for (auto &j : indices) {
-                uint index = replicas[0]->getReplicaIndex();
-                sumCorrK0[index] += runningCorr[index][i][j];
-
-                if (lattice->getProperties().rows % 2 == 0 &&
-                    displacements[i][j] == lattice->getProperties().rows / 2) {
-                    sumCorrKq[index] +=
-                        ((cdouble(runningCorr[index][i][j]) *
-                          std::exp(cdouble(0, q * displacements[i][j]))) +
-                         (cdouble(runningCorr[index][i][j]) *
-                          std::exp(cdouble(0, q * -displacements[i][j])))) /
-                        cdouble(2);
-                } else {
-                    sumCorrKq[index] +=
-                        cdouble(runningCorr[index][i][j]) *
-                        std::exp(cdouble(0, q * displacements[i][j]));
-                }
-            }
-        }
-    }
-
-    auto replicaIndices = lattice->getReplicaIndices();
-    for (auto &i : replicaIndices) {
-        addAvgMag(i, fabs(runningMag[i]) / cycleUpdates);
-        addAvgMag2(i, fabs(runningMag2[i]) / cycleUpdates);
-        addAvgMag4(i, fabs(runningMag4[i]) / cycleUpdates);
-        addChi0(
-            i, sumCorrK0[i] / cdouble(lattice->getNumIndices() * cycleUpdates));
-        addChiq(
-            i, sumCorrKq[i] / cdouble(lattice->getNumIndices() * cycleUpdates));
-    }
+    runUpdates(BASEUPDATES * static_cast<uint>(std::pow(2, power)));
 }
 
 uint SimulatedLattice::reachStability() {
@@ -223,7 +208,6 @@ uint SimulatedLattice::reachStability() {
 }
 
 uint SimulatedLattice::reachStabilityMag() {
-    auto configs = lattice->getConfigs();
     auto replicaIndices = lattice->getReplicaIndices();
 
     uint cycleUpdates;
@@ -242,7 +226,7 @@ uint SimulatedLattice::reachStabilityMag() {
             }
 
             for (auto &i : replicaIndices) {
-                mags[i] += configs[i][0]->getMagnetization();
+                mags[i] += lattice->getReplica(i).getMagnetization();
             }
         }
 
@@ -263,7 +247,8 @@ uint SimulatedLattice::reachStabilityMag() {
             }
 
             for (auto &i : replicaIndices) {
-                double magnetization = configs[i][0]->getMagnetization();
+                double magnetization =
+                    lattice->getReplica(i).getMagnetization();
                 cycleMags[i].push_back(magnetization);
             }
         }
@@ -309,9 +294,6 @@ uint SimulatedLattice::reachStabilityMag() {
 }
 
 uint SimulatedLattice::reachStabilityChi0() {
-    auto configs = lattice->getConfigs();
-    auto displacements = lattice->getXDisplacements();
-    auto indices = lattice->getIndices();
     auto numIndices = lattice->getNumIndices();
     auto replicaIndices = lattice->getReplicaIndices();
 
@@ -324,7 +306,6 @@ uint SimulatedLattice::reachStabilityChi0() {
     for (cycle = 1; cycle < binsToCompare; ++cycle) {
         cycleUpdates = BASEUPDATES * static_cast<uint>(std::pow(2, cycle));
         dmap chi0s;
-        imap3 runningCorr;
 
         for (uint num1 = 0; num1 < cycleUpdates; ++num1) {
             for (uint num2 = 0; num2 < SKIP; ++num2) {
@@ -332,25 +313,13 @@ uint SimulatedLattice::reachStabilityChi0() {
             }
 
             for (auto &i : replicaIndices) {
-                auto spins = configs[i][0]->getSpins();
-                for (auto &j : indices) {
-                    for (auto &k : indices) {
-                        runningCorr[i][j][k] += spins[j] * spins[k];
-                    }
-                }
+                double total = lattice->getReplica(i).getSpinSum();
+                chi0s[i] += total * total;
             }
         }
 
         for (auto &i : replicaIndices) {
-            double sumCorrK0 = 0;
-
-            for (auto &j : indices) {
-                for (auto &k : indices) {
-                    sumCorrK0 += runningCorr[i][j][k] / (int)cycleUpdates;
-                }
-            }
-
-            chi0s[i] = sumCorrK0 / numIndices;
+            chi0s[i] /= (double)cycleUpdates * numIndices;
         }
 
         bins.push_back(chi0s);
@@ -366,16 +335,8 @@ uint SimulatedLattice::reachStabilityChi0() {
             }
 
             for (auto &i : replicaIndices) {
-                auto spins = configs[i][0]->getSpins();
-                double sumCorrK0 = 0;
-
-                for (auto &j : indices) {
-                    for (auto &k : indices) {
-                        sumCorrK0 += spins[j] * spins[k];
-                    }
-                }
-
-                cycleChi0s[i].push_back(sumCorrK0 / numIndices);
+                double total = lattice->getReplica(i).getSpinSum();
+                cycleChi0s[i].push_back(total * total / numIndices);
             }
         }
 
@@ -420,7 +381,6 @@ uint SimulatedLattice::reachStabilityChi0() {
 }
 
 uint SimulatedLattice::reachStabilityEnergy() {
-    auto configs = lattice->getConfigs();
     auto replicaIndices = lattice->getReplicaIndices();
 
     uint cycleUpdates;
@@ -439,7 +399,7 @@ uint SimulatedLattice::reachStabilityEnergy() {
             }
 
             for (auto &i : replicaIndices) {
-                energies[i] += configs[i][0]->getTotalEnergy();
+                energies[i] += lattice->getReplica(i).getTotalEnergy();
             }
         }
 
@@ -460,7 +420,7 @@ uint SimulatedLattice::reachStabilityEnergy() {
             }
 
             for (auto &i : replicaIndices) {
-                double energy = configs[i][0]->getTotalEnergy();
+                double energy = lattice->getReplica(i).getTotalEnergy();
                 cycleEnergies[i].push_back(energy);
             }
         }
@@ -15,6 +15,9 @@ const uint SKIP = 10;
 const uint MAXCYCLES = 12;
 enum { MAG = 'm', CHI0 = 'x', ENERGY = 'e' };
 
+void findRowPhases(Lattice& lattice, double q, ivector& rowGroups,
+                   std::vector<cdvector>& rowPhases);
+
 class SimulatedLattice {
    public:
     SimulatedLattice(Lattice* lattice, const std::string& filename, uint index,
@@ -22,6 +25,9 @@ class SimulatedLattice {
                      bool suppress = false);
     ~SimulatedLattice() { delete lattice; }
     void runLatticeSimulation();
+    // Measures over cycleUpdates rounds of SKIP updates. Once a first call
+    // has sized its accumulators it allocates nothing.
+    void runUpdates(uint cycleUpdates);
     Lattice* getLattice() const { return lattice; }
     uint getIndLattice() const { return indLattice; }
     uint getUpdates() const { return updates; }
@@ -62,6 +68,18 @@ class SimulatedLattice {
     cdmap chi0;
     cdmap chiq;
 
+    ivector rowGroups;
+    std::vector<cdvector> rowPhases;
+    std::vector<wvector> rowMasks;
+    ivector rowSizes;
+
+    dvector runningMag;
+    dvector runningMag2;
+    dvector runningMag4;
+    dvector runningCorrK0;
+    cdvector runningCorrKq;
+    dvector rowSums;
+
     fs::path tempDirectory;
     fs::path tempFile;
     static std::mutex file_mutex;
@@ -69,7 +87,7 @@ class SimulatedLattice {
     void initTempFile(const std::string& filename);
     void updateTempFile();
     void runPreupdates();
-    void runUpdates();
+    void generateRowMasks();
     void runUpdatesStable();
     uint reachStability();
     uint reachStabilityMag();
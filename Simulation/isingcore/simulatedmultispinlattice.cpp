@@ -0,0 +1,270 @@
+#include "simulatedmultispinlattice.h"
+
+using namespace ising;
+
+SimulatedMultiSpinLattice::SimulatedMultiSpinLattice(
+    MultiSpinLattice *latt, const std::string &filename, const ivector &trials,
+    uint updates, uint preupdates, bool suppress)
+    : lattice(latt),
+      trials(trials),
+      updates(updates),
+      preupdates(preupdates) {
+    if (trials.size() != lattice->getLanes()) {
+        std::cout << "NUMBER OF TRIALS DOES NOT MATCH LANES! Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    q = 2 * ising::PI / lattice->getLattice()->getSize();
+
+    if (!suppress) {
+        initTempFiles(filename);
+    }
+
+    for (uint t = 0; t < lattice->getNumTemperatures(); ++t) {
+        temperatures[t] = lattice->getTemperature(t);
+    }
+
+    avgMag.resize(trials.size());
+    avgMag2.resize(trials.size());
+    avgMag4.resize(trials.size());
+    chi0.resize(trials.size());
+    chiq.resize(trials.size());
+
+    findRowPhases(*lattice->getLattice(), q, rowGroups, rowPhases);
+}
+
+void SimulatedMultiSpinLattice::initTempFiles(const std::string &filename) {
+    fs::path tempDirectory = fs::path(filename);
+    std::string name = tempDirectory.filename().string();
+
+    tempDirectory.remove_filename();
+    tempDirectory.replace_filename("temp/");
+
+    std::unique_lock<std::mutex> lock(file_mutex);
+    fs::create_directory(tempDirectory);
+    lock.unlock();
+
+    for (auto &trial : trials) {
+        std::ostringstream latticeName;
+        latticeName << trial << name;
+        tempFiles.push_back(tempDirectory / latticeName.str());
+
+        std::ofstream file(tempFiles.back());
+        file << "temperature,avg_mag,avg_mag2,avg_mag4,chi0_re,chi0_im,"
+             << "chiq_re,chiq_im\n";
+        file.close();
+    }
+}
+
+void SimulatedMultiSpinLattice::updateTempFiles() {
+    for (uint l = 0; l < tempFiles.size(); ++l) {
+        std::ofstream file(tempFiles[l],
+                           std::ofstream::out | std::ofstream::app);
+
+        for (auto &t : temperatures) {
+            uint i = t.first;
+            std::ostringstream row;
+            row << t.second << "," << avgMag[l][i] << "," << avgMag2[l][i]
+                << "," << avgMag4[l][i] << "," << chi0[l][i].real() << ","
+                << chi0[l][i].imag() << "," << chiq[l][i].real() << ","
+                << chiq[l][i].imag() << "\n";
+            file << row.str();
+        }
+
+        file.close();
+    }
+}
+
+void SimulatedMultiSpinLattice::runLatticeSimulation() {
+    runPreupdates();
+
+    if (updates == 0) {
+        uint powerMax = 8;
+        uint power = std::min(reachStability(), powerMax);
+        runUpdates(BASEUPDATES * static_cast<uint>(std::pow(2, power)));
+    } else {
+        runUpdates(updates);
+    }
+
+    updateTempFiles();
+}
+
+void SimulatedMultiSpinLattice::runPreupdates() {
+    for (uint i = 0; i < preupdates; ++i) {
+        lattice->update();
+    }
+}
+
+void SimulatedMultiSpinLattice::runUpdates(uint cycleUpdates) {
+    uint numT = lattice->getNumTemperatures();
+    uint lanes = lattice->getLanes();
+
+    runningMag.assign(numT, dvector(lanes));
+    runningMag2.assign(numT, dvector(lanes));
+    runningMag4.assign(numT, dvector(lanes));
+    runningCorrK0.assign(numT, dvector(lanes));
+    runningCorrKq.assign(numT, cdvector(lanes));
+
+    for (uint num1 = 0; num1 < cycleUpdates; ++num1) {
+        for (uint num2 = 0; num2 < SKIP; ++num2) {
+            lattice->update();
+        }
+
+        measure();
+    }
+
+    recordResults(cycleUpdates);
+}
+
+void SimulatedMultiSpinLattice::measure() {
+    uint numT = lattice->getNumTemperatures();
+    uint lanes = lattice->getLanes();
+    uint numIndices = lattice->getNumIndices();
+    dvector rowSums(rowPhases.size());
+
+    for (uint t = 0; t < numT; ++t) {
+        dvector magnetizations = lattice->getMagnetizations(t);
+        const wvector &words = lattice->getSpinWords(t);
+
+        for (uint l = 0; l < lanes; ++l) {
+            double m = magnetizations[l];
+            runningMag[t][l] += m;
+            runningMag2[t][l] += pow(m, 2);
+            runningMag4[t][l] += pow(m, 4);
+
+            double total = m * numIndices;
+            runningCorrK0[t][l] += total * total;
+
+            std::fill(rowSums.begin(), rowSums.end(), 0);
+            for (uint i = 0; i < numIndices; ++i) {
+                rowSums[rowGroups[i]] += ((words[i] >> l) & 1) ? -1 : 1;
+            }
+
+            const Kernels &kernels = getKernels();
+            for (uint a = 0; a < rowSums.size(); ++a) {
+                runningCorrKq[t][l] +=
+                    rowSums[a] * kernels.dotPhases(rowSums.data(),
+                                                   rowPhases[a].data(),
+                                                   rowSums.size());
+            }
+        }
+    }
+}
+
+void SimulatedMultiSpinLattice::recordResults(uint cycleUpdates) {
+    uint numIndices = lattice->getNumIndices();
+
+    for (uint l = 0; l < trials.size(); ++l) {
+        for (auto &t : temperatures) {
+            uint i = t.first;
+            double mag = fabs(runningMag[i][l]) / cycleUpdates;
+            double mag2 = fabs(runningMag2[i][l]) / cycleUpdates;
+            double mag4 = fabs(runningMag4[i][l]) / cycleUpdates;
+
+            if (mag > 1 || mag2 > 1 || mag4 > 1) {
+                std::cout << "\nInvalid average magnetization!";
+                std::cout << "Must be between 0.0 and 1.0\n\n";
+                exit(EXIT_FAILURE);
+            }
+
+            avgMag[l][i] = mag;
+            avgMag2[l][i] = mag2;
+            avgMag4[l][i] = mag4;
+            chi0[l][i] = cdouble(runningCorrK0[i][l]) /
+                         cdouble(numIndices * cycleUpdates);
+            chiq[l][i] =
+                runningCorrKq[i][l] / cdouble(numIndices * cycleUpdates);
+        }
+    }
+}
+
+uint SimulatedMultiSpinLattice::reachStability() {
+    uint numT = lattice->getNumTemperatures();
+    uint lanes = lattice->getLanes();
+
+    uint cycleUpdates;
+    uint cycle;
+    dvector2 bins;
+    uint binsToCompare = 3;
+    bool continueUpdating = true;
+
+    for (cycle = 1; cycle < binsToCompare; ++cycle) {
+        cycleUpdates = BASEUPDATES * static_cast<uint>(std::pow(2, cycle));
+        dvector mags(numT * lanes);
+
+        for (uint num1 = 0; num1 < cycleUpdates; ++num1) {
+            for (uint num2 = 0; num2 < SKIP; ++num2) {
+                lattice->update();
+            }
+
+            for (uint t = 0; t < numT; ++t) {
+                dvector magnetizations = lattice->getMagnetizations(t);
+                for (uint l = 0; l < lanes; ++l) {
+                    mags[t * lanes + l] += magnetizations[l];
+                }
+            }
+        }
+
+        for (auto &m : mags) {
+            m = fabs(m) / cycleUpdates;
+        }
+
+        bins.push_back(mags);
+    }
+
+    while (continueUpdating) {
+        cycleUpdates = BASEUPDATES * static_cast<uint>(std::pow(2, cycle));
+        dvector2 cycleMags(numT * lanes);
+
+        for (uint num1 = 0; num1 < cycleUpdates; ++num1) {
+            for (uint num2 = 0; num2 < SKIP; ++num2) {
+                lattice->update();
+            }
+
+            for (uint t = 0; t < numT; ++t) {
+                dvector magnetizations = lattice->getMagnetizations(t);
+                for (uint l = 0; l < lanes; ++l) {
+                    cycleMags[t * lanes + l].push_back(magnetizations[l]);
+                }
+            }
+        }
+
+        dvector means(numT * lanes), stds(numT * lanes);
+
+        for (uint i = 0; i < numT * lanes; ++i) {
+            means[i] =
+                std::accumulate(cycleMags[i].begin(), cycleMags[i].end(), 0.0) /
+                cycleUpdates;
+            stds[i] = std::sqrt(
+                std::accumulate(cycleMags[i].begin(), cycleMags[i].end(), 0.0,
+                                [&](double lhs, double rhs) {
+                                    return rhs + std::pow(lhs - means[i], 2);
+                                }) /
+                cycleUpdates);
+        }
+
+        continueUpdating = false;
+
+        for (uint i = 0; i < numT * lanes; ++i) {
+            if (cycle >= MAXCYCLES || continueUpdating == true) {
+                break;
+            }
+
+            for (int j = 1; j < static_cast<int>(binsToCompare); ++j) {
+                double difference =
+                    fabs((means[i] - bins.end()[-j][i]) / means[i]);
+
+                if (difference >= stds[i]) {
+                    continueUpdating = true;
+                }
+            }
+        }
+
+        if (continueUpdating) {
+            bins.push_back(means);
+            ++cycle;
+        }
+    }
+
+    return cycle;
+}
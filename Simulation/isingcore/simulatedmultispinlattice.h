@@ -0,0 +1,65 @@
+#ifndef SIMULATEDMULTISPINLATTICE_H_
+#define SIMULATEDMULTISPINLATTICE_H_
+
+#include "multispinlattice.h"
+#include "simulatedlattice.h"
+
+namespace ising {
+class SimulatedMultiSpinLattice {
+   public:
+    SimulatedMultiSpinLattice(MultiSpinLattice* lattice,
+                              const std::string& filename,
+                              const ivector& trials, uint updates,
+                              uint preupdates = PREUPDATES,
+                              bool suppress = false);
+    ~SimulatedMultiSpinLattice() { delete lattice; }
+    void runLatticeSimulation();
+    MultiSpinLattice* getLattice() const { return lattice; }
+    const ivector& getTrials() const { return trials; }
+    uint getUpdates() const { return updates; }
+    uint getPreupdates() const { return preupdates; }
+    double getQ() const { return q; }
+
+    const dmap& getTemperatures() const { return temperatures; }
+    const dmap& getAvgMag(uint lane) const { return avgMag[lane]; }
+    const dmap& getAvgMag2(uint lane) const { return avgMag2[lane]; }
+    const dmap& getAvgMag4(uint lane) const { return avgMag4[lane]; }
+    const cdmap& getChi0(uint lane) const { return chi0[lane]; }
+    const cdmap& getChiq(uint lane) const { return chiq[lane]; }
+
+   private:
+    MultiSpinLattice* lattice;
+    ivector trials;
+    uint updates;
+    uint preupdates;
+    double q;
+
+    dmap temperatures;
+    dmapvector avgMag;
+    dmapvector avgMag2;
+    dmapvector avgMag4;
+    std::vector<cdmap> chi0;
+    std::vector<cdmap> chiq;
+
+    ivector rowGroups;
+    std::vector<cdvector> rowPhases;
+    dvector2 runningMag;
+    dvector2 runningMag2;
+    dvector2 runningMag4;
+    dvector2 runningCorrK0;
+    std::vector<cdvector> runningCorrKq;
+
+    std::vector<fs::path> tempFiles;
+    static std::mutex file_mutex;
+
+    void initTempFiles(const std::string& filename);
+    void updateTempFiles();
+    void runPreupdates();
+    void runUpdates(uint cycleUpdates);
+    void measure();
+    void recordResults(uint cycleUpdates);
+    uint reachStability();
+};
+}
+
+#endif /* SIMULATEDMULTISPINLATTICE_H_ */
@@ -50,6 +50,7 @@ void Simulation::checkInputFile() {
         exit(EXIT_FAILURE);
     }
 
+    dense = file.peek() == DENSE;
     file.close();
 }
 
@@ -167,15 +168,20 @@ void Simulation::initLattices() {
 }
 
 void Simulation::initPersonalLattice() {
+    if (dense) {
+        return;
+    }
+
     std::unique_lock<std::mutex> lock(file_mutex);
     std::ifstream file(inFilename);
 
     char shape;
-    Hamiltonian hamiltonian = readHamiltonian(file, shape);
+    Hamiltonian hamiltonian = readHamiltonian(file, shape, true);
 
     file.close();
     lock.unlock();
 
+    hamiltonian.printReduction();
     Lattice *lattice = chooseLattice(shape, hamiltonian, minT, dT, numT, mode);
     personalLattice =
         std::make_unique<SimulatedLattice>(lattice, inFilename, 0, 0, 0, true);
@@ -186,12 +192,13 @@ void Simulation::addLattice(uint trial) {
     std::ifstream file(inFilename);
 
     char shape;
-    Hamiltonian hamiltonian = readHamiltonian(file, shape);
+    Hamiltonian hamiltonian = readHamiltonian(file, shape, true);
 
     file.close();
     lock.unlock();
 
     Lattice *lattice = chooseLattice(shape, hamiltonian, minT, dT, numT, mode);
+    lattice->seed(trial);
     auto simLattice = std::make_unique<SimulatedLattice>(
         lattice, inFilename, trial, updates, preupdates);
 
@@ -214,48 +221,31 @@ void Simulation::runTrials() {
 void Simulation::runTrial(uint trial) {
     lattices[trial]->runLatticeSimulation();
 
-    auto lAvgMag = lattices[trial]->getAvgMag();
-    auto lAvgMag2 = lattices[trial]->getAvgMag2();
-    auto lAvgMag4 = lattices[trial]->getAvgMag4();
-    auto lChi0 = lattices[trial]->getChi0();
-    auto lChiq = lattices[trial]->getChiq();
-
-    std::unique_lock<std::mutex> lock;
-
-    lock = std::unique_lock<std::mutex>(avgMag_mutex);
-    for (auto &mag : lAvgMag) {
-        addAvgMag(mag.first, mag.second);
-    }
-    lock.unlock();
-
-    lock = std::unique_lock<std::mutex>(avgMag2_mutex);
-    for (auto &mag : lAvgMag2) {
-        addAvgMag2(mag.first, mag.second);
-    }
-    lock.unlock();
-
-    lock = std::unique_lock<std::mutex>(avgMag4_mutex);
-    for (auto &mag : lAvgMag4) {
-        addAvgMag4(mag.first, mag.second);
-    }
-    lock.unlock();
-
-    lock = std::unique_lock<std::mutex>(chi0_mutex);
-    for (auto &x : lChi0) {
-        addChi0(x.first, x.second);
-    }
-    lock.unlock();
-
-    lock = std::unique_lock<std::mutex>(chiq_mutex);
-    for (auto &x : lChiq) {
-        addChiq(x.first, x.second);
-    }
-    lock.unlock();
+    addTrialResults(lattices[trial]->getAvgMag(), lattices[trial]->getAvgMag2(),
+                    lattices[trial]->getAvgMag4(), lattices[trial]->getChi0(),
+                    lattices[trial]->getChiq());
 }
 
 void Simulation::initRunTrials() {
     std::vector<std::function<void(void)>> runs;
 
+    if (dense) {
+        for (auto &trial : remainingTrials) {
+            runs.push_back([this, trial] { initRunDenseTrial(trial); });
+        }
+        remainingTrials.clear();
+    } else if (mode == MULTISPIN) {
+        while (!remainingTrials.empty()) {
+            ivector batch;
+            while (!remainingTrials.empty() && batch.size() < LANES) {
+                batch.push_back(remainingTrials.back());
+                remainingTrials.pop_back();
+            }
+
+            runs.push_back([this, batch] { initRunBatch(batch); });
+        }
+    }
+
     while (!remainingTrials.empty()) {
         auto &trial = remainingTrials.back();
         remainingTrials.pop_back();
@@ -269,12 +259,67 @@ void Simulation::initRunTrial(uint trial) {
     addLattice(trial);
     lattices[trial]->runLatticeSimulation();
 
-    auto lAvgMag = lattices[trial]->getAvgMag();
-    auto lAvgMag2 = lattices[trial]->getAvgMag2();
-    auto lAvgMag4 = lattices[trial]->getAvgMag4();
-    auto lChi0 = lattices[trial]->getChi0();
-    auto lChiq = lattices[trial]->getChiq();
+    addTrialResults(lattices[trial]->getAvgMag(), lattices[trial]->getAvgMag2(),
+                    lattices[trial]->getAvgMag4(), lattices[trial]->getChi0(),
+                    lattices[trial]->getChiq());
+}
 
+void Simulation::initRunBatch(const ivector &batch) {
+    std::unique_lock<std::mutex> lock(file_mutex);
+    std::ifstream file(inFilename);
+
+    char shape;
+    Hamiltonian hamiltonian = readHamiltonian(file, shape, true);
+
+    file.close();
+    lock.unlock();
+
+    Lattice *lattice = chooseLattice(shape, hamiltonian, minT, dT, numT, mode);
+    auto multiSpinLattice = new MultiSpinLattice(lattice, batch.size());
+    multiSpinLattice->seed(batch.front());
+    SimulatedMultiSpinLattice simLattice(multiSpinLattice, inFilename, batch,
+                                         updates, preupdates);
+    simLattice.runLatticeSimulation();
+
+    for (uint l = 0; l < batch.size(); ++l) {
+        addTrialResults(simLattice.getAvgMag(l), simLattice.getAvgMag2(l),
+                        simLattice.getAvgMag4(l), simLattice.getChi0(l),
+                        simLattice.getChiq(l));
+    }
+}
+
+// Integer couplings take the narrowest storage that holds them; real ones
+// run in float. Update modes do not apply to the dense engine.
+void Simulation::initRunDenseTrial(uint trial) {
+    std::unique_lock<std::mutex> lock(file_mutex);
+    std::ifstream file(inFilename);
+    DenseCouplings couplings = readDenseCouplings(file);
+    file.close();
+    lock.unlock();
+
+    if (couplings.integral && couplings.maxCoupling <= INT8_MAX) {
+        runDenseTrial<int8_t>(couplings, trial);
+    } else if (couplings.integral && couplings.maxCoupling <= INT16_MAX) {
+        runDenseTrial<int16_t>(couplings, trial);
+    } else {
+        runDenseTrial<float>(couplings, trial);
+    }
+}
+
+template <class J>
+void Simulation::runDenseTrial(const DenseCouplings &couplings, uint trial) {
+    SimulatedDenseLattice<J> simLattice(couplings, minT, dT, numT, inFilename,
+                                        trial, updates, preupdates);
+    simLattice.runLatticeSimulation();
+
+    addTrialResults(simLattice.getAvgMag(), simLattice.getAvgMag2(),
+                    simLattice.getAvgMag4(), simLattice.getChi0(),
+                    simLattice.getChiq());
+}
+
+void Simulation::addTrialResults(const dmap &lAvgMag, const dmap &lAvgMag2,
+                                 const dmap &lAvgMag4, const cdmap &lChi0,
+                                 const cdmap &lChiq) {
     std::unique_lock<std::mutex> lock;
 
     lock = std::unique_lock<std::mutex>(avgMag_mutex);
@@ -419,7 +464,12 @@ double Simulation::getBinderCumulant(uint n) {
     return 1 - getAvgMag4(n) / (3 * pow(getAvgMag2(n), 2));
 }
 
+// Dense Hamiltonians have no geometry, so no correlation length is defined
 cdouble Simulation::getCorrelationFunction(uint n) {
+    if (dense) {
+        return 0;
+    }
+
     return cdouble(
         1 / (2 * personalLattice->getSize() * sin(personalLattice->getQ())) *
         sqrt((getChi0(n) / getChiq(n)) - cdouble(1)));
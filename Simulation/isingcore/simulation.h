@@ -2,7 +2,9 @@
 #define SIMULATION_H_
 
 #include "isinghelpers.h"
+#include "simulateddenselattice.h"
 #include "simulatedlattice.h"
+#include "simulatedmultispinlattice.h"
 #include "threadpool.h"
 #include "threadpoolhelpers.h"
 
@@ -77,6 +79,13 @@ class Simulation {
     void runTrial(uint trial);
     void initRunTrials();
     void initRunTrial(uint trial);
+    void initRunBatch(const ivector &batch);
+    void initRunDenseTrial(uint trial);
+    template <class J>
+    void runDenseTrial(const DenseCouplings &couplings, uint trial);
+    void addTrialResults(const dmap &lAvgMag, const dmap &lAvgMag2,
+                         const dmap &lAvgMag4, const cdmap &lChi0,
+                         const cdmap &lChiq);
 
     const std::string &inFilename;
     double minT;
@@ -86,6 +95,8 @@ class Simulation {
     uint preupdates;
     uint trials;
     char mode;
+    // Fully connected inputs run on the dense engine, with no Lattice
+    bool dense = false;
 
     latticemap lattices;
     latticeptr personalLattice;
@@ -0,0 +1,95 @@
+#ifndef STENCILS_H_
+#define STENCILS_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace ising {
+enum { NO_STENCIL, SQUARE_NN, TRIANGLE_NN, SQUARE_NNN, TRIANGLE_NNN };
+
+// Row and column shift from an index to one of its forward neighbors, in the
+// order generate_hamiltonian.py emits them. The backward neighbors are the
+// negated offsets.
+struct StencilOffset {
+    int dc;
+    int dr;
+};
+
+template <int S>
+struct Stencil;
+
+template <>
+struct Stencil<SQUARE_NN> {
+    static constexpr int FORWARD = 2;
+    static constexpr int REACH = 1;
+    static constexpr StencilOffset offsets[FORWARD] = {{1, 0}, {0, 1}};
+};
+
+template <>
+struct Stencil<TRIANGLE_NN> {
+    static constexpr int FORWARD = 3;
+    static constexpr int REACH = 1;
+    static constexpr StencilOffset offsets[FORWARD] = {{1, 0}, {0, 1}, {1, 1}};
+};
+
+template <>
+struct Stencil<SQUARE_NNN> {
+    static constexpr int FORWARD = 6;
+    static constexpr int REACH = 2;
+    static constexpr StencilOffset offsets[FORWARD] = {
+        {1, 0}, {0, 1}, {2, 0}, {0, 2}, {1, -1}, {1, 1}};
+};
+
+template <>
+struct Stencil<TRIANGLE_NNN> {
+    static constexpr int FORWARD = 9;
+    static constexpr int REACH = 2;
+    static constexpr StencilOffset offsets[FORWARD] = {
+        {1, 0}, {0, 1}, {1, 1}, {2, 0}, {0, 2},
+        {2, 1}, {1, -1}, {1, 2}, {2, 2}};
+};
+
+// Couplings of a periodic lattice matched to a stencil. Index i owns bonds
+// [i * 2 * FORWARD, (i + 1) * 2 * FORWARD): its forward bonds in offset
+// order, then its backward bonds. columns[c + REACH] is column c wrapped
+// onto the lattice for c in [-REACH, cols + REACH). kind is NO_STENCIL when
+// the Hamiltonian did not match, in which case kernels use
+// CompiledInteractions.
+struct StencilInteractions {
+    int kind = NO_STENCIL;
+    int reach = 0;
+    std::vector<int8_t> couplings;
+    std::vector<int> columns;
+};
+
+template <bool WRAP>
+inline int wrapColumn(const int* columns, int c) {
+    return WRAP ? columns[c] : c;
+}
+
+// Local field of the index at column c, given the first index of each row
+// from REACH rows above to REACH rows below it and the wrapped columns
+// (offset so that columns[0] is column 0). Columns within REACH of an edge
+// must be evaluated with WRAP set.
+template <int S, bool WRAP, class Spins>
+inline int findStencilField(const Spins& spins, const int8_t* couplings,
+                            const int* rowStarts, const int* columns, int c) {
+    typedef Stencil<S> St;
+    int field = 0;
+
+    for (int b = 0; b < St::FORWARD; ++b) {
+        const StencilOffset& o = St::offsets[b];
+        int forward =
+            rowStarts[St::REACH + o.dr] + wrapColumn<WRAP>(columns, c + o.dc);
+        int backward =
+            rowStarts[St::REACH - o.dr] + wrapColumn<WRAP>(columns, c - o.dc);
+
+        field += couplings[b] * spins[forward];
+        field += couplings[St::FORWARD + b] * spins[backward];
+    }
+
+    return field;
+}
+}
+
+#endif /* STENCILS_H_ */
@@ -1,8 +1,97 @@
+#include <cassert>
+#include <functional>
 #include <iostream>
 #include "hamiltonian.h"
+#include "randomgenerator.h"
 
 using namespace ising;
 
+// Energy -sum J prod s of the terms, with spins looked up by label
+int findEnergy(const ivector2 &terms, const imap &spins) {
+    int energy = 0;
+
+    for (auto &term : terms) {
+        int product = 1;
+        for (auto it = term.begin() + 1; it != term.end(); ++it) {
+            product *= spins.at(*it);
+        }
+
+        energy -= term[0] * product;
+    }
+
+    return energy;
+}
+
+imap drawSpins(const ivector &indices, RandomGenerator &gen) {
+    imap spins;
+
+    for (auto &i : indices) {
+        spins[i] = (gen.randInt() & 1) ? 1 : -1;
+    }
+
+    return spins;
+}
+
+// The canonical Hamiltonian must give every configuration the energy of
+// its input, up to the constant of the terms it dropped for having no
+// indices left. Relabelling the indices, reversing each term and reversing
+// the order of terms must give the same terms and energies under the
+// relabelled configuration.
+void testCanonicalization(const ivector2 &input) {
+    RandomGenerator gen(7, 0);
+    Hamiltonian h(input);
+    ivector indices = h.getIndices();
+
+    for (auto &term : h.getHamiltonian()) {
+        assert(term[0] != 0 && "Canonical term without coupling!\n");
+        assert(std::adjacent_find(term.begin() + 1, term.end(),
+                                  std::greater_equal<int>()) == term.end() &&
+               "Canonical term not strictly sorted!\n");
+    }
+
+    ivector labels = indices;
+    for (uint i = labels.size(); i > 1; --i) {
+        std::swap(labels[i - 1], labels[gen.randInt() % i]);
+    }
+
+    imap relabel;
+    for (uint i = 0; i < indices.size(); ++i) {
+        relabel[indices[i]] = labels[i];
+    }
+
+    ivector2 relabelled;
+    for (auto it = input.rbegin(); it != input.rend(); ++it) {
+        ivector term = {(*it)[0]};
+        for (auto i = it->rbegin(); i != it->rend() - 1; ++i) {
+            term.push_back(relabel[*i]);
+        }
+        relabelled.push_back(term);
+    }
+
+    Hamiltonian r(relabelled);
+    assert(r.getNumTerms() == h.getNumTerms() &&
+           "Relabelling changed the number of terms!\n");
+
+    int offset = 0;
+    for (int k = 0; k < 8; ++k) {
+        imap spins = drawSpins(indices, gen);
+        imap relabelledSpins;
+        for (auto &s : spins) {
+            relabelledSpins[relabel[s.first]] = s.second;
+        }
+
+        int energy = findEnergy(h.getHamiltonian(), spins);
+        if (k == 0) {
+            offset = findEnergy(input, spins) - energy;
+        }
+
+        assert(findEnergy(input, spins) - energy == offset &&
+               "Canonical energy differs from the input energy!\n");
+        assert(findEnergy(r.getHamiltonian(), relabelledSpins) == energy &&
+               "Relabelling changed the canonical energy!\n");
+    }
+}
+
 int main(int argc, char *argv[]) {
     if (argc != 2) {
         printf("Usage: %s name_of_hamiltonian_file\n\n", argv[0]);
@@ -33,13 +122,25 @@ int main(int argc, char *argv[]) {
         lineStream >> cols;
     }
 
-    Hamiltonian h =
-        Hamiltonian(importHamiltonianVector(file), shape, rows, cols);
+    ivector2 input = importHamiltonianVector(file);
+    Hamiltonian h = Hamiltonian(input, shape, rows, cols);
 
     file.close();
 
+    testCanonicalization(input);
+    // Permuted duplicates cancelling to zero, repeated indices and a term
+    // whose indices all cancel
+    testCanonicalization({{1, 0, 1},
+                          {2, 1, 0},
+                          {1, 2, 2, 3},
+                          {-3, 0, 1},
+                          {4, 5, 5},
+                          {-2, 3, 5, 1},
+                          {1, 1, 5, 3}});
+
     std::cout << std::endl;
 
+    h.printReduction();
     h.printHamiltonian();
     h.printIndices();
     h.printLocations();
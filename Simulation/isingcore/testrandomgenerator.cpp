@@ -0,0 +1,105 @@
+#include <cassert>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "randomgenerator.h"
+
+using namespace ising;
+
+// A batched fill must draw the same floats as calls of randFloatCO, from
+// any position within a block, and leave the generator where those calls
+// would have left it
+void testFillFloatCO(uint32_t skip, size_t n) {
+    RandomGenerator scalar(42, RandomGenerator::makeStream(1, 2, 3));
+    RandomGenerator batched(42, RandomGenerator::makeStream(1, 2, 3));
+
+    for (uint32_t i = 0; i < skip; ++i) {
+        assert(scalar.randInt() == batched.randInt() &&
+               "Generators of one stream diverged!\n");
+    }
+
+    std::vector<float> expected(n);
+    std::vector<float> filled(n);
+
+    for (auto &u : expected) {
+        u = scalar.randFloatCO();
+        assert(u >= 0 && u < 1 && "Uniform outside [0, 1)!\n");
+    }
+
+    batched.fillFloatCO(filled.data(), n);
+
+    assert(filled == expected && "Batched fill differs from scalar draws!\n");
+
+    for (int i = 0; i < 8; ++i) {
+        assert(scalar.randInt() == batched.randInt() &&
+               "Batched fill left the stream elsewhere!\n");
+    }
+}
+
+// Philox4x32-10 known answers from the Random123 distribution: key, counter
+// and the block they give. A state of key, counter and a used-up buffer is
+// loaded, so the next four draws are exactly that block.
+void testKnownAnswers() {
+    const uint32_t vectors[3][10] = {
+        {0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+         0x00000000, 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8},
+        {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+         0xffffffff, 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd},
+        {0xa4093822, 0x299f31d0, 0x243f6a88, 0x85a308d3, 0x13198a2e,
+         0x03707344, 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}};
+
+    for (auto &v : vectors) {
+        std::stringstream state;
+        state << v[0] << " " << v[1] << " " << v[2] << " " << v[3] << " "
+              << v[4] << " " << v[5] << " " << 4;
+
+        RandomGenerator gen;
+        gen.load(state);
+
+        for (int i = 0; i < 4; ++i) {
+            assert(gen.randInt() == v[6 + i] &&
+                   "Philox4x32-10 differs from the known answer!\n");
+        }
+    }
+
+    RandomGenerator seeded(0, 0);
+    assert(seeded.randInt() == vectors[0][6] &&
+           "Seed and stream do not map to key and counter!\n");
+}
+
+// A generator loaded from a saved state continues the stream of the saved
+// one, from any position within a block
+void testSaveLoad(uint32_t skip) {
+    RandomGenerator saved(99, RandomGenerator::makeStream(4, 5, 6));
+
+    for (uint32_t i = 0; i < skip; ++i) {
+        saved.randInt();
+    }
+
+    std::stringstream state;
+    saved.save(state);
+
+    RandomGenerator loaded(1, 2);
+    loaded.load(state);
+
+    for (int i = 0; i < 16; ++i) {
+        assert(saved.randInt() == loaded.randInt() &&
+               "Loaded generator left the saved stream!\n");
+    }
+}
+
+int main() {
+    testKnownAnswers();
+
+    for (uint32_t skip = 0; skip < 9; ++skip) {
+        testSaveLoad(skip);
+    }
+
+    for (uint32_t skip = 0; skip < 5; ++skip) {
+        for (size_t n : {0, 1, 3, 4, 31, 32, 33, 100, 257}) {
+            testFillFloatCO(skip, n);
+        }
+    }
+
+    std::cout << "Random generator tests passed" << std::endl;
+}
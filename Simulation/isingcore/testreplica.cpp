@@ -1,9 +1,281 @@
 #include <cassert>
+#include <cmath>
 #include <iostream>
+#include <numeric>
 #include "lattices.h"
+#include "multispinlattice.h"
 
 using namespace ising;
 
+// Periodic square ferromagnet of the given side
+Hamiltonian makeFerromagnet(int size) {
+    ivector2 terms;
+    for (int i = 0; i < size * size; ++i) {
+        terms.push_back({1, i, i / size * size + (i + 1) % size});
+        terms.push_back({1, i, (i + size) % (size * size)});
+    }
+
+    return Hamiltonian(terms, 's', size, size);
+}
+
+// A Houdayer move flips one cluster of disagreeing indices in both replicas
+// of a temperature, after relabelling replica 0 so at most half disagree.
+// The overlap of the pair is kept up to that relabelling, so is their summed
+// energy, and from random spins every temperature has a cluster to flip.
+// The arena of VECTORIZED mode runs the same move on its own storage.
+void testHoudayerMove(char mode) {
+    Lattice lattice(makeFerromagnet(16), 1, .5, 4, mode);
+    lattice.seed(3);
+
+    for (uint t = 0; t < 4; ++t) {
+        cvector a0 = lattice.getReplica(t, 0).getSpins();
+        cvector a1 = lattice.getReplica(t, 1).getSpins();
+        int energy = lattice.getReplica(t, 0).getTotalEnergy() +
+                     lattice.getReplica(t, 1).getTotalEnergy();
+
+        lattice.houdayerClusterMove(t);
+
+        cvector b0 = lattice.getReplica(t, 0).getSpins();
+        cvector b1 = lattice.getReplica(t, 1).getSpins();
+        int relabel = b0[0] * b1[0] * a0[0] * a1[0];
+        uint flipped = 0;
+
+        for (uint i = 0; i < a0.size(); ++i) {
+            assert(b0[i] * b1[i] == relabel * a0[i] * a1[i] &&
+                   "Houdayer move changed the overlap!\n");
+            flipped += b1[i] != a1[i];
+        }
+
+        assert(flipped > 0 && "Houdayer move flipped nothing!\n");
+        assert(lattice.getReplica(t, 0).getTotalEnergy() +
+                       lattice.getReplica(t, 1).getTotalEnergy() ==
+                   energy &&
+               "Houdayer move changed the summed energy!\n");
+    }
+}
+
+// Swendsen-Wang moves split across the sweep pool must build and flip the
+// same clusters as on one thread
+void testSwendsenWangThreads() {
+    Lattice lattice(makeFerromagnet(128), 2.3, 0, 1, SWENDSEN_WANG);
+    cvector expected;
+
+    for (uint threads : {1, 2, 4}) {
+        lattice.setSweepThreads(threads);
+        Replica replica(lattice.getProperties(), 0);
+        replica.seed(7, 0);
+        for (int i = 0; i < 10; ++i) {
+            replica.update();
+        }
+
+        if (expected.empty()) {
+            expected = replica.getSpins();
+        }
+        assert(replica.getSpins() == expected &&
+               "Swendsen-Wang clusters depend on the thread count!\n");
+    }
+}
+
+// Energy -sum J prod s of the lattice's terms, from the spins alone
+int findEnergy(const LatticeProperties &prop, const cvector &spins) {
+    int energy = 0;
+
+    for (auto &interaction : prop.hFunction) {
+        int product = 1;
+        for (auto it = interaction.begin() + 1; it != interaction.end();
+             ++it) {
+            product *= spins[*it];
+        }
+
+        energy -= interaction[0] * product;
+    }
+
+    return energy;
+}
+
+// The energies and spin sums replicas keep up to date as they sweep and
+// swap must match those recomputed from their spins, whether the sweep
+// goes through cached local fields, the arena of VECTORIZED mode, the
+// stencils of ALL mode, the demons of DEMON mode or the n-fold way. An
+// n-fold temperature, when given, must sit above the whole ladder of 1 to 2.5.
+void testSweepEnergies(const Hamiltonian &h, char mode, bool fields,
+                       double nFoldTemperature = 0) {
+    Lattice lattice(h, 1, .5, 4, mode);
+    lattice.setLocalFields(fields);
+    lattice.setNFoldTemperature(nFoldTemperature);
+    lattice.seed(2);
+    assert((mode != ALL ||
+            lattice.getProperties().stencil.kind != NO_STENCIL) &&
+           "No stencil to test!\n");
+
+    for (int k = 0; k < 5; ++k) {
+        lattice.monteCarloSweep();
+        lattice.parallelTemperingUpdate();
+
+        for (uint t = 0; t < 4; ++t) {
+            for (uint j = 0; j < REPLICAS; ++j) {
+                const Replica &replica = lattice.getReplica(t, j);
+                cvector spins = replica.getSpins();
+                int sum = std::accumulate(spins.begin(), spins.end(), 0);
+
+                assert(replica.getTotalEnergy() ==
+                           findEnergy(lattice.getProperties(), spins) &&
+                       "Swept energy differs from the recomputed one!\n");
+                assert(replica.getSpinSum() == sum &&
+                       "Swept spin sum differs from the recomputed one!\n");
+                // The n-fold way turns on local fields the first time it runs
+                assert((nFoldTemperature == 0 || replica.hasLocalFields()) &&
+                       "The n-fold way never ran!\n");
+            }
+        }
+    }
+}
+
+// Real couplings stay on the sparse path: the energies replicas keep in
+// double, from float local fields, must match those recomputed from their
+// spins up to float rounding
+void testRealSweepEnergies(const Hamiltonian &h, char mode) {
+    ivector2 terms = h.getHamiltonian();
+    dvector2 real;
+
+    for (uint k = 0; k < terms.size(); ++k) {
+        real.push_back(dvector(terms[k].begin(), terms[k].end()));
+        real[k][0] *= .3 + .17 * (k % 7);
+    }
+
+    Lattice lattice(Hamiltonian(real, h.getShape(), h.getRows(), h.getCols()),
+                    1, .5, 4, mode);
+    lattice.seed(2);
+
+    for (int k = 0; k < 80; ++k) {
+        lattice.monteCarloSweep();
+        lattice.parallelTemperingUpdate();
+
+        for (uint t = 0; t < 4; ++t) {
+            const Replica &replica = lattice.getReplica(t);
+            cvector spins = replica.getSpins();
+            double energy = 0;
+
+            for (auto &term : real) {
+                double product = term[0];
+                for (auto it = term.begin() + 1; it != term.end(); ++it) {
+                    product *= spins[(int)*it];
+                }
+
+                energy -= product;
+            }
+
+            assert(replica.hasRealCouplings() &&
+                   "Real couplings were rounded to integers!\n");
+            assert(std::abs(replica.getEnergy() - energy) <
+                       1e-3 * (1 + std::abs(energy)) &&
+                   "Swept real energy differs from the recomputed one!\n");
+        }
+    }
+}
+
+// Flipping coupling signs in place must leave a lattice that sweeps exactly
+// like one built from the flipped Hamiltonian, stencils included
+void testCouplingSigns(const Hamiltonian &h, char mode) {
+    Lattice flipped(h, 1, .5, 4, mode);
+    cvector signs(h.getNumTerms());
+    ivector2 terms = h.getHamiltonian();
+
+    for (uint k = 0; k < signs.size(); ++k) {
+        signs[k] = (k % 3 == 1) ? -1 : 1;
+        terms[k][0] *= signs[k];
+    }
+
+    flipped.setCouplingSigns(signs);
+    Lattice rebuilt(Hamiltonian(terms, h.getShape(), h.getRows(), h.getCols()),
+                    1, .5, 4, mode);
+
+    assert(flipped.getProperties().hFunction ==
+               rebuilt.getProperties().hFunction &&
+           "Flipped couplings differ from the rebuilt Hamiltonian!\n");
+
+    flipped.seed(5);
+    rebuilt.seed(5);
+
+    for (int k = 0; k < 5; ++k) {
+        flipped.monteCarloSweep();
+        rebuilt.monteCarloSweep();
+    }
+
+    for (uint t = 0; t < 4; ++t) {
+        for (uint j = 0; j < REPLICAS; ++j) {
+            const Replica &a = flipped.getReplica(t, j);
+            const Replica &b = rebuilt.getReplica(t, j);
+            assert(a.getSpins() == b.getSpins() &&
+                   a.getTotalEnergy() == b.getTotalEnergy() &&
+                   "Flipped couplings sweep unlike the rebuilt lattice!\n");
+        }
+    }
+}
+
+// Packed spins take pairwise products from bit parity, and must sweep
+// exactly like one char per index from the same seed
+void testPackedSweeps(const Hamiltonian &h) {
+    Lattice packed(h, 1, .5, 4, PSEUDO);
+    Lattice bytes(h, 1, .5, 4, PSEUDO);
+    packed.setPackedSpins(true);
+    bytes.setPackedSpins(false);
+    packed.seed(3);
+    bytes.seed(3);
+
+    for (int k = 0; k < 5; ++k) {
+        packed.monteCarloSweep();
+        bytes.monteCarloSweep();
+    }
+
+    for (uint t = 0; t < 4; ++t) {
+        for (uint j = 0; j < REPLICAS; ++j) {
+            const Replica &a = packed.getReplica(t, j);
+            const Replica &b = bytes.getReplica(t, j);
+            assert(a.getSpins() == b.getSpins() &&
+                   a.getTotalEnergy() == b.getTotalEnergy() &&
+                   a.getTotalEnergy() ==
+                       findEnergy(packed.getProperties(), a.getSpins()) &&
+                   "Packed spins sweep unlike one char per index!\n");
+        }
+    }
+}
+
+// Every lane of the multi-spin engine is a trial of its own: the energy and
+// magnetization it reports per lane must match those recomputed from the
+// lane's spins, and the lanes must not move in lockstep. A partial word of
+// lanes checks that the unused bits stay out of the counts.
+void testMultiSpinLanes(const Hamiltonian &h) {
+    const uint lanes = 48;
+    MultiSpinLattice multi(new Lattice(h, 1, .5, 4, MULTISPIN), lanes);
+    multi.seed(2);
+
+    for (int k = 0; k < 5; ++k) {
+        multi.update();
+
+        for (uint t = 0; t < 4; ++t) {
+            ivector energies = multi.getTotalEnergies(t);
+            uint lockstep = 0;
+            dvector magnetizations = multi.getMagnetizations(t);
+            assert(energies.size() == lanes && magnetizations.size() == lanes);
+
+            for (uint l = 0; l < lanes; ++l) {
+                cvector spins = multi.getSpins(t, l);
+                int sum = std::accumulate(spins.begin(), spins.end(), 0);
+
+                assert(energies[l] ==
+                           findEnergy(multi.getProperties(), spins) &&
+                       "Lane energy differs from the recomputed one!\n");
+                assert(magnetizations[l] == (double)sum / spins.size() &&
+                       "Lane magnetization differs from the spin sum!\n");
+                lockstep += spins == multi.getSpins(t, 0);
+            }
+
+            assert(lockstep < lanes && "Lanes sweep in lockstep!\n");
+        }
+    }
+}
+
 int main(int argc, char *argv[]) {
     if (argc != 2) {
         printf("Usage: %s name_of_hamiltonian_file\n\n", argv[0]);
@@ -136,4 +408,26 @@ int main(int argc, char *argv[]) {
     std::cout << "Magnetization: " << replica.getMagnetization() << std::endl;
 
     std::cout << std::endl;
+
+    testHoudayerMove(PSEUDO);
+    testHoudayerMove(VECTORIZED);
+    testSwendsenWangThreads();
+    testSweepEnergies(h, PSEUDO, true);
+    testSweepEnergies(h, VECTORIZED, false);
+    testSweepEnergies(makeFerromagnet(16), ALL, false);
+    testSweepEnergies(h, PSEUDO, false, 3);
+    testSweepEnergies(makeFerromagnet(16), PSEUDO, false, 3);
+    testSweepEnergies(h, DEMON, false);
+    testSweepEnergies(h, DEMON, true);
+    testSweepEnergies(makeFerromagnet(16), DEMON, false);
+    testRealSweepEnergies(h, PSEUDO);
+    testRealSweepEnergies(h, COLORED);
+    testRealSweepEnergies(makeFerromagnet(16), ALL);
+    testPackedSweeps(h);
+    testPackedSweeps(makeFerromagnet(16));
+    testMultiSpinLanes(h);
+    testMultiSpinLanes(makeFerromagnet(16));
+    testCouplingSigns(h, PSEUDO);
+    testCouplingSigns(makeFerromagnet(16), PSEUDO);
+    testCouplingSigns(makeFerromagnet(16), ALL);
 }
\ No newline at end of file
@@ -24,4 +24,9 @@ unsigned int ising::getNumThreads(unsigned int remaining) {
     }
 
     return numThreads;
-}
\ No newline at end of file
+}
+
+ThreadPool& ising::getSweepPool() {
+    static ThreadPool pool(getMaxThreads());
+    return pool;
+}
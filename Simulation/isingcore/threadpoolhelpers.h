@@ -15,6 +15,25 @@ void runInPool(Iter begin, Iter end, unsigned int threadCount) {
 
 unsigned int getMaxThreads();
 unsigned int getNumThreads(unsigned int remaining);
+// Pool shared by the sweeps of every lattice, started on first use with
+// getMaxThreads() workers and kept for the rest of the run
+ThreadPool& getSweepPool();
+
+// Runs f(k) for every k in [0, n): k = 0 on the calling thread, the rest on
+// the sweep pool. Returns once all of them have finished.
+template <class F>
+void runSweepTasks(unsigned int n, F f) {
+    std::vector<std::future<void>> tasks;
+    for (unsigned int k = 1; k < n; ++k) {
+        tasks.push_back(getSweepPool().enqueue(f, k));
+    }
+
+    f(0);
+
+    for (auto& task : tasks) {
+        task.get();
+    }
+}
 }
 
 #endif /* THREADPOOLHELPERS_H_ */
\ No newline at end of file
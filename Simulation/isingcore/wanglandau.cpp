@@ -0,0 +1,450 @@
+#include <thread>
+#include "wanglandau.h"
+
+using namespace ising;
+
+WangLandau::WangLandau(Lattice* lattice, uint numWindows, uint walkers,
+                       double finalLogF)
+    : lattice(lattice),
+      prop(lattice->getProperties()),
+      finalLogF(finalLogF) {
+    if (numWindows == 0 || walkers == 0 || walkers > 128) {
+        std::cout << "WANG-LANDAU NEEDS 1 TO 128 WALKERS IN AT LEAST ONE "
+                  << "WINDOW! Exiting...\n\n";
+        exit(EXIT_FAILURE);
+    }
+
+    gen.setStream(RandomGenerator::getRunSeed(),
+                  RandomGenerator::makeStream(0, 2 * numWindows, 0));
+    initWindows(numWindows, walkers);
+}
+
+double WangLandau::getExchangeRate(uint window) const {
+    const EnergyWindow& w = windows[window];
+    return w.exchanges == 0 ? 0 : (double)w.accepted / w.exchanges;
+}
+
+// Window k draws from stream (trial, k, walker) for its replicas and from
+// (trial, windows + k, walker) for its walks; exchanges use the stream after
+void WangLandau::seed(uint trial) {
+    uint64_t runSeed = RandomGenerator::getRunSeed();
+    uint numWindows = windows.size();
+    gen.setStream(runSeed,
+                  RandomGenerator::makeStream(trial, 2 * numWindows, 0));
+
+    for (uint k = 0; k < numWindows; ++k) {
+        EnergyWindow& window = windows[k];
+
+        for (uint j = 0; j < window.walkers.size(); ++j) {
+            window.walkers[j]->seed(runSeed,
+                                    RandomGenerator::makeStream(trial, k, j));
+            window.gens[j].setStream(
+                runSeed,
+                RandomGenerator::makeStream(trial, numWindows + k, j));
+        }
+    }
+}
+
+// Quenches a random replica until no flip moves its energy further in
+// direction. Flips that leave the energy unchanged are taken now and then so
+// the quench can cross plateaus.
+int WangLandau::findEnergyBound(int direction) {
+    Replica replica(prop, 0);
+    replica.seed(gen.randLong(), gen.randLong());
+    int bound = replica.getTotalEnergy();
+
+    for (uint sweep = 0; sweep < WINDOW_ENTRY_SWEEPS; ++sweep) {
+        bool improved = false;
+
+        for (uint i = 0; i < prop.numIndices; ++i) {
+            int index = gen.randInt() % prop.numIndices;
+            int change = -2 * replica.getIndexEnergy(index) * direction;
+
+            if (change > 0 || (change == 0 && gen.randInt() % 8 == 0)) {
+                replica.flipSpin(index);
+                improved |= change > 0;
+            }
+        }
+
+        bound = direction * std::max(direction * bound,
+                                     direction * replica.getTotalEnergy());
+
+        if (!improved) {
+            break;
+        }
+    }
+
+    return bound;
+}
+
+// Splits the energies between quenched minimum and maximum into windows of
+// equal width, each sharing WINDOW_OVERLAP of it with the next. The outer
+// windows reach the hard bounds +/-sum|J|, in case the quench stopped short.
+void WangLandau::initWindows(uint numWindows, uint walkers) {
+    int hardBound = 0;
+    for (auto& interaction : prop.hFunction) {
+        hardBound += std::abs(interaction[0]);
+    }
+
+    int low = findEnergyBound(-1);
+    int high = findEnergyBound(1);
+    double width =
+        (high - low) / (numWindows - (numWindows - 1) * WINDOW_OVERLAP);
+
+    windows.resize(numWindows);
+    for (uint k = 0; k < numWindows; ++k) {
+        EnergyWindow& window = windows[k];
+        double begin = low + k * width * (1 - WINDOW_OVERLAP);
+
+        window.low = k == 0 ? -hardBound : (int)std::floor(begin);
+        window.high = k == numWindows - 1 ? hardBound
+                                          : (int)std::ceil(begin + width);
+        window.logF = 1;
+        window.inverseTime = false;
+        window.visitedBins = 0;
+        window.steps = 0;
+        window.converged = false;
+        window.exchanges = 0;
+        window.accepted = 0;
+
+        uint bins = window.high - window.low + 1;
+        window.logDensity.assign(bins, 0);
+        window.histogram.assign(bins, 0);
+        window.visited.assign(bins, false);
+        window.sumMag.assign(bins, 0);
+        window.sumMag2.assign(bins, 0);
+        window.sumMag4.assign(bins, 0);
+        window.samples.assign(bins, 0);
+
+        for (uint j = 0; j < walkers; ++j) {
+            window.walkers.push_back(std::make_shared<Replica>(prop, j));
+            window.gens.emplace_back();
+        }
+    }
+
+    seed(0);
+}
+
+// Drives a walker greedily toward the middle of its window, taking a move
+// away from it now and then so the walk cannot stall
+void WangLandau::enterWindow(EnergyWindow& window, Replica& walker,
+                             RandomGenerator& walkerGen) {
+    int middle = (window.low + window.high) / 2;
+
+    for (uint step = 0; step < WINDOW_ENTRY_SWEEPS * prop.numIndices;
+         ++step) {
+        int energy = walker.getTotalEnergy();
+
+        if (energy >= window.low && energy <= window.high) {
+            return;
+        }
+
+        int index = walkerGen.randInt() % prop.numIndices;
+        int next = energy - 2 * walker.getIndexEnergy(index);
+
+        if (std::abs(next - middle) < std::abs(energy - middle) ||
+            walkerGen.randInt() % 16 == 0) {
+            walker.flipSpin(index);
+        }
+    }
+
+    std::cout << "WALKER COULD NOT REACH ENERGY WINDOW [" << window.low << ", "
+              << window.high << "]! Exiting...\n\n";
+    exit(EXIT_FAILURE);
+}
+
+// Wang-Landau steps restricted to the window: a flip to energy next is
+// taken with probability min(1, g(E) / g(next)), after which ln g(E) grows
+// by ln f at whichever energy the walker is left at
+void WangLandau::sampleWindow(EnergyWindow& window) {
+    for (uint j = 0; j < window.walkers.size(); ++j) {
+        enterWindow(window, *window.walkers[j], window.gens[j]);
+    }
+
+    for (uint sweep = 0; sweep < EXCHANGE_SWEEPS; ++sweep) {
+        if (window.inverseTime) {
+            window.logF = (double)window.visitedBins / window.steps;
+        }
+
+        for (uint j = 0; j < window.walkers.size(); ++j) {
+            Replica& walker = *window.walkers[j];
+            RandomGenerator& walkerGen = window.gens[j];
+
+            for (uint i = 0; i < prop.numIndices; ++i) {
+                int index = walkerGen.randInt() % prop.numIndices;
+                int bin = walker.getTotalEnergy() - window.low;
+                int next = bin - 2 * walker.getIndexEnergy(index);
+
+                if (next >= 0 && next <= window.high - window.low) {
+                    double diff =
+                        window.logDensity[bin] - window.logDensity[next];
+
+                    if (diff >= 0 || exp(diff) > walkerGen.randFloatCO()) {
+                        walker.flipSpin(index);
+                        bin = next;
+                    }
+                }
+
+                double m = std::abs(walker.getMagnetization());
+                double m2 = m * m;
+
+                if (!window.visited[bin]) {
+                    window.visited[bin] = true;
+                    window.visitedBins++;
+                }
+
+                window.logDensity[bin] += window.logF;
+                window.histogram[bin]++;
+                window.steps++;
+                window.sumMag[bin] += m;
+                window.sumMag2[bin] += m2;
+                window.sumMag4[bin] += m2 * m2;
+                window.samples[bin]++;
+            }
+        }
+    }
+}
+
+// Energies the window has never reached do not count against flatness
+bool WangLandau::checkFlatness(EnergyWindow& window) {
+    uint64_t total = 0;
+    uint64_t least = UINT64_MAX;
+    uint bins = 0;
+
+    for (uint b = 0; b < window.histogram.size(); ++b) {
+        if (window.visited[b]) {
+            total += window.histogram[b];
+            least = std::min(least, window.histogram[b]);
+            bins++;
+        }
+    }
+
+    return bins > 1 && least >= FLATNESS * total / bins;
+}
+
+// Swaps a random walker of each window with parity with one of the next
+// window, when both energies lie in the overlap, with probability
+// min(1, g_k(Ea) g_k+1(Eb) / (g_k(Eb) g_k+1(Ea)))
+void WangLandau::exchangeWalkers(uint parity) {
+    for (uint k = parity; k + 1 < windows.size(); k += 2) {
+        EnergyWindow& lower = windows[k];
+        EnergyWindow& upper = windows[k + 1];
+
+        if (lower.converged || upper.converged) {
+            continue;
+        }
+
+        uint a = gen.randInt() % lower.walkers.size();
+        uint b = gen.randInt() % upper.walkers.size();
+        int energyA = lower.walkers[a]->getTotalEnergy();
+        int energyB = upper.walkers[b]->getTotalEnergy();
+
+        lower.exchanges++;
+
+        if (energyA < upper.low || energyB > lower.high) {
+            continue;
+        }
+
+        double diff = lower.logDensity[energyA - lower.low] -
+                      lower.logDensity[energyB - lower.low] +
+                      upper.logDensity[energyB - upper.low] -
+                      upper.logDensity[energyA - upper.low];
+
+        if (diff >= 0 || exp(diff) > gen.randFloatCO()) {
+            std::swap(lower.walkers[a], upper.walkers[b]);
+            lower.accepted++;
+        }
+    }
+}
+
+void WangLandau::run() {
+    uint numWindows = windows.size();
+    uint finished = 0;
+
+    for (uint round = 0; finished < numWindows; ++round) {
+        std::vector<std::thread> workers;
+
+        for (auto& window : windows) {
+            if (!window.converged) {
+                workers.emplace_back(
+                    [this, &window] { sampleWindow(window); });
+            }
+        }
+
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        for (uint k = 0; k < numWindows; ++k) {
+            EnergyWindow& window = windows[k];
+
+            if (window.converged) {
+                continue;
+            }
+
+            if (!window.inverseTime && checkFlatness(window)) {
+                window.logF /= 2;
+                std::fill(window.histogram.begin(), window.histogram.end(),
+                          0);
+                window.inverseTime =
+                    window.logF * window.steps < window.visitedBins;
+            }
+
+            if (window.inverseTime) {
+                window.logF = (double)window.visitedBins / window.steps;
+            }
+
+            if (window.logF < finalLogF) {
+                window.converged = true;
+                finished++;
+                std::cout << "Window " << k << " [" << window.low << ", "
+                          << window.high << "] converged after " << round + 1
+                          << " rounds\n";
+            }
+        }
+
+        exchangeWalkers(round % 2);
+    }
+
+    joinWindows();
+}
+
+// Joins each window to the last at the shared energy where their slopes of
+// ln g agree best, then normalizes the sum of g(E) to 2^N
+void WangLandau::joinWindows() {
+    logDensity.clear();
+    avgMag.clear();
+    avgMag2.clear();
+    avgMag4.clear();
+
+    dmap sumMag, sumMag2, sumMag4;
+    std::map<int, uint64_t> samples;
+    int joint = windows[0].low;
+    double shift = 0;
+
+    for (uint k = 0; k < windows.size(); ++k) {
+        const EnergyWindow& window = windows[k];
+
+        if (k > 0) {
+            const EnergyWindow& last = windows[k - 1];
+            ivector shared;
+
+            for (int e = window.low; e <= last.high; ++e) {
+                if (last.visited[e - last.low] &&
+                    window.visited[e - window.low]) {
+                    shared.push_back(e);
+                }
+            }
+
+            if (shared.empty()) {
+                std::cout << "ENERGY WINDOWS " << k - 1 << " AND " << k
+                          << " DO NOT OVERLAP! Exiting...\n\n";
+                exit(EXIT_FAILURE);
+            }
+
+            // A single shared energy has no slope to compare
+            double bestGap = INFINITY;
+            joint = shared[0];
+
+            for (uint i = 0; i + 1 < shared.size(); ++i) {
+                int e = shared[i];
+                int f = shared[i + 1];
+                double gap = std::abs(last.logDensity[f - last.low] -
+                                      last.logDensity[e - last.low] -
+                                      window.logDensity[f - window.low] +
+                                      window.logDensity[e - window.low]);
+
+                if (gap < bestGap) {
+                    bestGap = gap;
+                    joint = e;
+                }
+            }
+
+            shift = logDensity[joint] - window.logDensity[joint - window.low];
+            logDensity.erase(logDensity.lower_bound(joint), logDensity.end());
+        }
+
+        for (int e = window.low; e <= window.high; ++e) {
+            uint b = e - window.low;
+
+            if (!window.visited[b]) {
+                continue;
+            }
+
+            if (e >= joint) {
+                logDensity[e] = window.logDensity[b] + shift;
+            }
+
+            sumMag[e] += window.sumMag[b];
+            sumMag2[e] += window.sumMag2[b];
+            sumMag4[e] += window.sumMag4[b];
+            samples[e] += window.samples[b];
+        }
+    }
+
+    double largest = -INFINITY;
+    for (auto& g : logDensity) {
+        largest = std::max(largest, g.second);
+    }
+
+    double sum = 0;
+    for (auto& g : logDensity) {
+        sum += exp(g.second - largest);
+    }
+
+    double offset = prop.numIndices * log(2) - largest - log(sum);
+    for (auto& g : logDensity) {
+        g.second += offset;
+        avgMag[g.first] = sumMag[g.first] / samples[g.first];
+        avgMag2[g.first] = sumMag2[g.first] / samples[g.first];
+        avgMag4[g.first] = sumMag4[g.first] / samples[g.first];
+    }
+}
+
+// Returns <E>, <E^2>, <|m|>, <m^2> and <m^4> at temperature t
+dvector WangLandau::findMoments(double t) const {
+    double largest = -INFINITY;
+    for (auto& g : logDensity) {
+        largest = std::max(largest, g.second - g.first / t);
+    }
+
+    dvector moments(5, 0);
+    double partition = 0;
+
+    for (auto& g : logDensity) {
+        double weight = exp(g.second - g.first / t - largest);
+        double e = g.first;
+
+        partition += weight;
+        moments[0] += weight * e;
+        moments[1] += weight * e * e;
+        moments[2] += weight * avgMag.at(g.first);
+        moments[3] += weight * avgMag2.at(g.first);
+        moments[4] += weight * avgMag4.at(g.first);
+    }
+
+    for (auto& m : moments) {
+        m /= partition;
+    }
+
+    return moments;
+}
+
+double WangLandau::getEnergy(double t) const {
+    return findMoments(t)[0] / prop.numIndices;
+}
+
+double WangLandau::getSpecificHeat(double t) const {
+    dvector moments = findMoments(t);
+    return (moments[1] - moments[0] * moments[0]) /
+           (prop.numIndices * t * t);
+}
+
+double WangLandau::getMagnetization(double t) const {
+    return findMoments(t)[2];
+}
+
+double WangLandau::getBinderCumulant(double t) const {
+    dvector moments = findMoments(t);
+    return 1 - moments[4] / (3 * moments[3] * moments[3]);
+}
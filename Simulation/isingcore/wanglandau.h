@@ -0,0 +1,95 @@
+#ifndef WANGLANDAU_H_
+#define WANGLANDAU_H_
+
+#include "lattices.h"
+
+namespace ising {
+// Fraction of its width each energy window shares with the next
+const double WINDOW_OVERLAP = 0.75;
+// A histogram is flat once every energy visited in its window has been
+// counted at least this fraction of the mean
+const double FLATNESS = 0.8;
+const double FINAL_LOG_F = 1e-6;
+// Sweeps each walker makes between replica exchanges and flatness checks
+const uint EXCHANGE_SWEEPS = 100;
+// Sweeps a walker may take to reach its window, or to find an energy bound
+const uint WINDOW_ENTRY_SWEEPS = 10000;
+
+// Replica-exchange Wang-Landau estimate of the density of states g(E) of an
+// integer-energy Hamiltonian. The energy range is split into overlapping
+// windows, each sampled in its own thread by walkers that share the window's
+// estimate of ln g and only visit energies inside it. Walkers of
+// neighboring windows exchange configurations between rounds. Once every
+// window has converged the estimates are joined where their slopes agree
+// best and normalized to 2^N states. Microcanonical averages of the
+// magnetization are recorded along the way, so canonical averages follow at
+// any temperature.
+class WangLandau {
+   public:
+    WangLandau(Lattice* lattice, uint numWindows, uint walkers,
+               double finalLogF = FINAL_LOG_F);
+    WangLandau(const WangLandau&) = delete;
+    WangLandau& operator=(const WangLandau&) = delete;
+    ~WangLandau() { delete lattice; }
+
+    Lattice* getLattice() const { return lattice; }
+    uint getNumWindows() const { return windows.size(); }
+    double getExchangeRate(uint window) const;
+    void seed(uint trial);
+    void run();
+
+    // ln g(E) over the energies reached, normalized to 2^N states
+    const dmap& getLogDensity() const { return logDensity; }
+    double getEnergy(double t) const;
+    double getSpecificHeat(double t) const;
+    double getMagnetization(double t) const;
+    double getBinderCumulant(double t) const;
+
+   private:
+    struct EnergyWindow {
+        int low;
+        int high;
+        double logF;
+        // Past the halving stage ln f follows bins / steps, which keeps the
+        // error of ln g from saturating
+        bool inverseTime;
+        uint visitedBins;
+        uint64_t steps;
+        bool converged;
+        dvector logDensity;
+        std::vector<uint64_t> histogram;
+        cvector visited;
+        replicavector walkers;
+        std::vector<RandomGenerator> gens;
+        dvector sumMag;
+        dvector sumMag2;
+        dvector sumMag4;
+        std::vector<uint64_t> samples;
+        uint64_t exchanges;
+        uint64_t accepted;
+    };
+
+    int findEnergyBound(int direction);
+    void initWindows(uint numWindows, uint walkers);
+    void enterWindow(EnergyWindow& window, Replica& walker,
+                     RandomGenerator& walkerGen);
+    void sampleWindow(EnergyWindow& window);
+    bool checkFlatness(EnergyWindow& window);
+    void exchangeWalkers(uint parity);
+    void joinWindows();
+    // Boltzmann-weighted average of powers of the energy and magnetization
+    dvector findMoments(double t) const;
+
+    Lattice* lattice;
+    const LatticeProperties& prop;
+    double finalLogF;
+    std::vector<EnergyWindow> windows;
+    dmap logDensity;
+    dmap avgMag;
+    dmap avgMag2;
+    dmap avgMag4;
+    RandomGenerator gen;
+};
+}
+
+#endif /* WANGLANDAU_H_ */
@@ -62,6 +62,7 @@ def find_exec_path(directory, filename):
 
 
 SHAPES = [RECTANGLE, SQUARE, TRIANGLE, STRIANGLE] = ['r', 's', 't', 'v']
+DENSE = 'd'
 DIR_NAMES = ['magnetizations', 'binder_cumulants', 'correlation_functions']
 ROOT_NAME = 'Simulation'
 MAKE_NAME = 'Makefile'
@@ -10,10 +10,16 @@ Output Hamiltonian as .csv file
             1,0,2
             1,1,2
             ...
+Dense (all-to-all) Hamiltonians instead store the upper triangle of the
+coupling matrix
+    Format: d,N
+            J(0,1),J(0,2),...,J(0,N-1)
+            J(1,2),...,J(1,N-1)
+            ...
 '''
 
 import sys
-from random import randint
+from random import gauss, randint
 import config as cf
 
 
@@ -136,6 +142,68 @@ def generate_rectangle_toric(neighbors, coupling, disorder, rows, cols, coupling
 # end generate_rectangle_toric
 
 
+def generate_plaquettes(body, coupling, disorder, rows, cols):
+    '''
+    Generate list of k-body plaquette interactions for rectangular lattice
+    Four-body terms couple each index with its right, bottom, and
+    bottom-right neighbors; three-body terms split each such square into its
+    upper-left and lower-right triangles
+    Return Hamiltonian of plaquette terms for lattice of size rows x cols
+    '''
+
+    hamiltonian = []
+
+    for index in range(rows * cols):
+        right = shift_index(index, rows, cols, 1, 0)
+        bottom = shift_index(index, rows, cols, 0, 1)
+        corner = shift_index(index, rows, cols, 1, 1)
+
+        if body == 4:
+            hamiltonian.append([add_disorder(coupling, disorder),
+                                index, right, bottom, corner])
+        else:
+            hamiltonian.append([add_disorder(coupling, disorder),
+                                index, right, bottom])
+            hamiltonian.append([add_disorder(coupling, disorder),
+                                right, bottom, corner])
+
+    return hamiltonian
+
+# end generate_plaquettes
+
+
+def generate_dense(coupling, disorder, size, gaussian=False):
+    '''
+    Generate upper triangle of coupling matrix for fully connected
+    (Sherrington-Kirkpatrick style) lattice of 'size' indices
+    Gaussian couplings are drawn with mean 0 and standard deviation 'coupling'
+    Return list of rows, row i holding couplings between i and indices after it
+    '''
+
+    if gaussian:
+        return [['%.6g' % gauss(0, coupling) for _ in range(index + 1, size)]
+                for index in range(size - 1)]
+
+    return [[add_disorder(coupling, disorder) for _ in range(index + 1, size)]
+            for index in range(size - 1)]
+
+# end generate_dense
+
+
+def draw_gaussian(hamiltonian, deviation):
+    '''
+    Replace the coupling of every interaction with one drawn with mean 0 and
+    standard deviation 'deviation', as for an Edwards-Anderson spin glass
+    Return Hamiltonian with real couplings, which isingsimulation keeps sparse
+    and runs in modes a, p, r or c
+    '''
+
+    return [['%.6g' % gauss(0, deviation)] + interaction[1:]
+            for interaction in hamiltonian]
+
+# end draw_gaussian
+
+
 def generate_square(neighbors, coupling, disorder, size, coupling2=0, toric=False):
     '''
     Generate list of interacting indices with their couplings for square
@@ -336,14 +404,22 @@ def write_hamiltonian(filename, hamiltonian, shape, rows, cols):
     First line of .csv contains character for shape and row and column count
     Second line contains headers for columns 'coupling,index1,index2'
     Subsequent lines contain each interaction as 'coupling,index1,index2'
+    Dense Hamiltonians instead give 'd,N' and then rows of the upper triangle
+    Interactions with zero coupling are left out of sparse Hamiltonians
     '''
 
     hamiltonian_file = open(filename, 'w')
 
-    hamiltonian_file.write(shape + ',' + str(rows) + ',' + str(cols) + '\n')
+    if shape == cf.DENSE:
+        hamiltonian_file.write(shape + ',' + str(rows) + '\n')
+    else:
+        hamiltonian_file.write(shape + ',' + str(rows) + ',' + str(cols) + '\n')
     # hamiltonian_file.write('coupling,index1,index2,rows,cols\n')
 
     for interaction in hamiltonian:
+        if shape != cf.DENSE and interaction[0] == 0:
+            continue
+
         hamiltonian_file.write(','.join(map(str, interaction)) + '\n')
 
     hamiltonian_file.close()
@@ -359,18 +435,52 @@ def receive_input():
     '''
 
     shape = str(input('Enter lattice shape ("s" - square, "r" - rectangle, ' +
-                      '"t" - triangle): '))
-    while shape not in cf.SHAPES:
-        shape = str(input('Invalid input. Please enter "s", "r", or "t": '))
+                      '"t" - triangle, "d" - dense): '))
+    while shape not in cf.SHAPES + [cf.DENSE]:
+        shape = str(input('Invalid input. Please enter "s", "r", "t", or "d": '))
+
+    if shape == cf.DENSE:
+        gaussian = str(input('Gaussian couplings (y/n): ')).lower() == 'y'
 
-    neighbors = 2 if int(input('Enter 1 for nearest neighbor interactions, ' +
-                               '2 for nearest and next nearest: ')) == 2 else 1
-    toric = True if str(input('Toric code (y/n): ')).lower() == 'y' else False
+        while True:
+            try:
+                if gaussian:
+                    coupling = float(input('Enter coupling standard deviation: '))
+                    disorder = 0
+                else:
+                    coupling = int(input('Enter integer coupling: '))
+                    disorder = int(input('Enter disorder [0, 100]: '))
+                size = int(input('Enter number of indices: '))
+                break
+            except ValueError:
+                print('Invalid input -- not a number!')
+
+        return (generate_dense(coupling, disorder, size, gaussian), shape, size,
+                size)
+
+    neighbors = int(input('Enter 1 for nearest neighbor interactions, ' +
+                          '2 for nearest and next nearest, 3 or 4 for ' +
+                          'three- or four-body plaquettes: '))
+    if neighbors in [3, 4] and shape not in [cf.SQUARE, cf.RECTANGLE]:
+        raise ValueError('Plaquette interactions need a square or rectangular '
+                         + 'lattice, not shape "' + shape + '"')
+    if neighbors not in [3, 4]:
+        neighbors = 2 if neighbors == 2 else 1
+        toric = True if str(input('Toric code (y/n): ')).lower() == 'y' else False
+    else:
+        toric = False
+
+    gaussian = (neighbors == 1 and
+                str(input('Gaussian couplings (y/n): ')).lower() == 'y')
 
     while True:
         try:
-            coupling = int(input('Enter integer coupling: '))
-            disorder = int(input('Enter disorder [0, 100]: '))
+            if gaussian:
+                coupling = float(input('Enter coupling standard deviation: '))
+                disorder = 0
+            else:
+                coupling = int(input('Enter integer coupling: '))
+                disorder = int(input('Enter disorder [0, 100]: '))
             if neighbors == 2:
                 coupling2 = int(
                     input('Enter next-nearest neighbor integer coupling: '))
@@ -378,7 +488,7 @@ def receive_input():
                 coupling2 = 0
             break
         except ValueError:
-            print('Invalid input -- not an integer!')
+            print('Invalid input -- not a number!')
 
     if shape in [cf.SQUARE, cf.STRIANGLE]:
         while True:
@@ -389,7 +499,9 @@ def receive_input():
             except ValueError:
                 print('Invalid input -- not an integer!')
 
-        hamiltonian = (generate_square(neighbors, coupling, disorder, rows, coupling2, toric)
+        hamiltonian = (generate_plaquettes(neighbors, coupling, disorder, rows, cols)
+                       if neighbors in [3, 4]
+                       else generate_square(neighbors, coupling, disorder, rows, coupling2, toric)
                        if shape == cf.SQUARE
                        else generate_striangle(neighbors, coupling, disorder, rows,
                                                coupling2, toric))
@@ -403,12 +515,17 @@ def receive_input():
             except ValueError:
                 print('Invalid input -- not an integer!')
 
-        hamiltonian = (generate_rectangle(neighbors, coupling, disorder, rows, cols,
-                                          coupling2, toric)
+        hamiltonian = (generate_plaquettes(neighbors, coupling, disorder, rows, cols)
+                       if neighbors in [3, 4]
+                       else generate_rectangle(neighbors, coupling, disorder, rows, cols,
+                                               coupling2, toric)
                        if shape == cf.RECTANGLE
                        else generate_triangle(neighbors, coupling, disorder, rows, cols,
                                               coupling2, toric))
 
+    if gaussian:
+        hamiltonian = draw_gaussian(hamiltonian, coupling)
+
     return (hamiltonian, shape, rows, cols)
 
 # end receive_input